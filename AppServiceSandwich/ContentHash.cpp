@@ -0,0 +1,104 @@
+#include "ContentHash.hpp"
+#include <cstring>
+
+static const unsigned long long Prime1 = 11400714785074694791ull;
+static const unsigned long long Prime2 = 14029467366897019727ull;
+static const unsigned long long Prime3 = 1609587929392839161ull;
+static const unsigned long long Prime4 = 9650029242287828579ull;
+static const unsigned long long Prime5 = 2870177450012600261ull;
+
+static inline unsigned long long RotateLeft(unsigned long long value, int bits)
+{
+	return (value << bits) | (value >> (64 - bits));
+}
+
+// unaligned little endian reads, memcpy compiles to a single load
+static inline unsigned long long Read64(const unsigned char* p)
+{
+	unsigned long long value;
+	std::memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+static inline unsigned long long Read32(const unsigned char* p)
+{
+	unsigned int value;
+	std::memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+static inline unsigned long long Round(unsigned long long accumulator, unsigned long long input)
+{
+	accumulator += input * Prime2;
+	accumulator = RotateLeft(accumulator, 31);
+	return accumulator * Prime1;
+}
+
+static inline unsigned long long MergeRound(unsigned long long accumulator, unsigned long long value)
+{
+	accumulator ^= Round(0, value);
+	return accumulator * Prime1 + Prime4;
+}
+
+unsigned long long ContentHash(const void* data, size_t size, unsigned long long seed)
+{
+	auto p = static_cast<const unsigned char*>(data);
+	auto end = p + size;
+	unsigned long long hash;
+
+	if (size >= 32)
+	{
+		// 4 independent lanes, the cpu runs them in parallel
+		unsigned long long v1 = seed + Prime1 + Prime2;
+		unsigned long long v2 = seed + Prime2;
+		unsigned long long v3 = seed;
+		unsigned long long v4 = seed - Prime1;
+		auto limit = end - 32;
+		do
+		{
+			v1 = Round(v1, Read64(p));
+			v2 = Round(v2, Read64(p + 8));
+			v3 = Round(v3, Read64(p + 16));
+			v4 = Round(v4, Read64(p + 24));
+			p += 32;
+		} while (p <= limit);
+
+		hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+		hash = MergeRound(hash, v1);
+		hash = MergeRound(hash, v2);
+		hash = MergeRound(hash, v3);
+		hash = MergeRound(hash, v4);
+	}
+	else
+	{
+		hash = seed + Prime5;
+	}
+
+	hash += static_cast<unsigned long long>(size);
+
+	while (p + 8 <= end)
+	{
+		hash ^= Round(0, Read64(p));
+		hash = RotateLeft(hash, 27) * Prime1 + Prime4;
+		p += 8;
+	}
+	if (p + 4 <= end)
+	{
+		hash ^= Read32(p) * Prime1;
+		hash = RotateLeft(hash, 23) * Prime2 + Prime3;
+		p += 4;
+	}
+	while (p < end)
+	{
+		hash ^= (*p) * Prime5;
+		hash = RotateLeft(hash, 11) * Prime1;
+		p++;
+	}
+
+	hash ^= hash >> 33;
+	hash *= Prime2;
+	hash ^= hash >> 29;
+	hash *= Prime3;
+	hash ^= hash >> 32;
+	return hash;
+}
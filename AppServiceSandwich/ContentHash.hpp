@@ -0,0 +1,6 @@
+#pragma once
+#include <cstddef>
+
+// fast non-cryptographic 64 bit hash of a block of memory, used to detect if a file really changed
+// the algorithm is XXH64, so values match other xxHash implementations with the same seed
+unsigned long long ContentHash(const void* data, size_t size, unsigned long long seed = 0);
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// a whole file mapped into memory for reading, the contents are not copied
+class FileMapping
+{
+public:
+	// map the file, if it doesn't exist then IsOpen returns false, other errors throw std::runtime_error
+	explicit FileMapping(const std::string& fileName);
+
+	FileMapping(const FileMapping& other) = delete;
+	FileMapping& operator=(const FileMapping& other) = delete;
+
+	~FileMapping();
+
+	// true if the file exists and was mapped
+	bool IsOpen() const { return isOpen; }
+
+	// start of the file contents, nullptr for empty files
+	const char* Data() const { return data; }
+
+	size_t Size() const { return size; }
+
+private:
+	bool isOpen = false;
+	const char* data = nullptr;
+	size_t size = 0;
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+};
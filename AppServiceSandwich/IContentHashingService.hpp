@@ -0,0 +1,10 @@
+#pragma once
+#include "ResourcePath.hpp"
+
+class IContentHashingService
+{
+public:
+	// return a hash of the file contents, 0 means there is no information available
+	virtual unsigned long long GetFileContentHash(const ResourcePath& filePath) = 0;
+	virtual ~IContentHashingService() { }
+};
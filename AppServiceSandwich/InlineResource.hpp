@@ -0,0 +1,168 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+#include "ResourcePath.hpp"
+#include "ResourcePathMap.hpp"
+
+class ResourceManagerLocation;
+
+// small resources, like config entries, which are stored by value instead of as ManagedResource objects
+// there is no allocation, vtable or reference count for each of them, values of a type are kept in contiguous chunks
+// see ResourceManager::RegisterInlineFactory and ResourceManager::RequireInline
+template <typename T> class InlineResourceFactory
+{
+public:
+	static_assert(std::is_trivially_copyable<T>::value, "inline resources must be trivially copyable");
+	static_assert(std::is_default_constructible<T>::value, "inline resources must be default constructible");
+
+	// build the value of a resource, called again with the same path when it changes
+	virtual T Build(const ResourcePath& resourcePath, ResourceManagerLocation& resourceManager) = 0;
+
+	virtual ~InlineResourceFactory() { }
+};
+
+template <typename T> struct InlineResourceSlot
+{
+	// odd while the value is being written, a reader copies the value and retries if the sequence changed meanwhile
+	std::atomic<uint32_t> sequence{ 0 };
+	T value;
+};
+
+// points to an inline resource, it's just the address of the value, so it's free to copy
+// the value stays there until the manager is destroyed
+template <typename T> class InlineResourcePtr
+{
+public:
+	InlineResourcePtr() : slot(nullptr) { }
+
+	explicit InlineResourcePtr(const InlineResourceSlot<T>* slot) : slot(slot) { }
+
+	bool IsNull() const { return slot == nullptr; }
+
+	// a copy of the current value, never a mix of two versions even while it's being reloaded
+	T Get() const
+	{
+		T value;
+		uint32_t before;
+		do
+		{
+			before = slot->sequence.load(std::memory_order_acquire);
+			std::memcpy(static_cast<void*>(&value), &slot->value, sizeof(T));
+			std::atomic_thread_fence(std::memory_order_acquire);
+		} while ((before & 1) != 0 || slot->sequence.load(std::memory_order_relaxed) != before);
+		return value;
+	}
+
+	// 1 for the first version, incremented each time the value is reloaded
+	unsigned Generation() const { return slot->sequence.load(std::memory_order_acquire) / 2; }
+
+	bool operator==(const InlineResourcePtr& other) const { return slot == other.slot; }
+	bool operator!=(const InlineResourcePtr& other) const { return slot != other.slot; }
+
+private:
+	const InlineResourceSlot<T>* slot;
+};
+
+// the part of an inline resource table which the manager uses without knowing the type
+class InlineResourceTableBase
+{
+public:
+	virtual ~InlineResourceTableBase() { }
+
+	// build the resource again if it's in the table, returns false if it's not
+	virtual bool Reload(const ResourcePath& path, ResourceManagerLocation& location) = 0;
+
+	virtual size_t Size() = 0;
+};
+
+// all inline resources of one type, values are stored in chunks which never move
+template <typename T> class InlineResourceTable : public InlineResourceTableBase
+{
+public:
+	explicit InlineResourceTable(InlineResourceFactory<T>& factory) : factory(&factory) { }
+
+	InlineResourceFactory<T>& Factory()
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		return *factory;
+	}
+
+	void SetFactory(InlineResourceFactory<T>& factory)
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		this->factory = &factory;
+	}
+
+	// null if it's not loaded
+	InlineResourcePtr<T> Find(const ResourcePath& path)
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		auto entry = index.Find(path);
+		return entry == nullptr ? InlineResourcePtr<T>() : InlineResourcePtr<T>(entry->value);
+	}
+
+	// add a value which was built outside the lock, if another thread added the same path meanwhile that one is kept
+	InlineResourcePtr<T> Insert(const ResourcePath& path, const T& value)
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		auto inserted = index.Insert(path);
+		if (inserted.second)
+		{
+			if (count % ChunkSize == 0)
+			{
+				chunks.emplace_back(new InlineResourceSlot<T>[ChunkSize]);
+			}
+			auto slot = &chunks.back()[count % ChunkSize];
+			count++;
+			slot->value = value;
+			slot->sequence.store(2, std::memory_order_release);
+			inserted.first->value = slot;
+		}
+		return InlineResourcePtr<T>(inserted.first->value);
+	}
+
+	bool Reload(const ResourcePath& path, ResourceManagerLocation& location) override
+	{
+		InlineResourceSlot<T>* slot;
+		InlineResourceFactory<T>* builder;
+		{
+			std::lock_guard<std::mutex> guard(mutex);
+			auto entry = index.Find(path);
+			if (entry == nullptr)
+			{
+				return false;
+			}
+			slot = entry->value;
+			builder = factory;
+		}
+		T value = builder->Build(path, location);
+
+		std::lock_guard<std::mutex> guard(mutex);
+		uint32_t sequence = slot->sequence.load(std::memory_order_relaxed);
+		slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		std::memcpy(static_cast<void*>(&slot->value), &value, sizeof(T));
+		slot->sequence.store(sequence + 2, std::memory_order_release);
+		return true;
+	}
+
+	size_t Size() override
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		return count;
+	}
+
+private:
+	static const size_t ChunkSize = 4096;
+
+	InlineResourceFactory<T>* factory;
+	std::mutex mutex;
+	ResourcePathMap<InlineResourceSlot<T>*> index;
+	std::vector<std::unique_ptr<InlineResourceSlot<T>[]>> chunks;
+	size_t count = 0;
+};
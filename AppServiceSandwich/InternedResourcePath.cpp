@@ -0,0 +1,49 @@
+#include "InternedResourcePath.hpp"
+#include <stdexcept>
+
+ResourcePathTable& ResourcePathTable::Global()
+{
+	// never destroyed, so interned paths can be used by other static objects until the process ends
+	static ResourcePathTable* table = new ResourcePathTable();
+	return *table;
+}
+
+ResourcePathTable::ResourcePathTable()
+{
+	Intern(ResourcePath());
+}
+
+ResourcePathTable::~ResourcePathTable()
+{
+	for (auto& chunk : chunks)
+	{
+		delete[] chunk.load();
+	}
+}
+
+uint32_t ResourcePathTable::Intern(const ResourcePath& path)
+{
+	size_t hash = ResourcePathMap<uint32_t>::Hash(path);
+	std::lock_guard<std::mutex> guard(mutex);
+	auto found = index.Find(path, hash);
+	if (found != nullptr)
+	{
+		return found->value;
+	}
+	uint32_t id = count.load(std::memory_order_relaxed);
+	if (id >> ChunkBits >= MaxChunks)
+	{
+		throw std::runtime_error("Too many interned resource paths");
+	}
+	if ((id & (ChunkSize - 1)) == 0)
+	{
+		chunks[id >> ChunkBits].store(new Entry[ChunkSize], std::memory_order_release);
+	}
+	auto entry = index.Insert(path, hash).first;
+	entry->value = id;
+	auto& slot = chunks[id >> ChunkBits].load(std::memory_order_relaxed)[id & (ChunkSize - 1)];
+	slot.path = &entry->key;
+	slot.hash = hash;
+	count.store(id + 1, std::memory_order_release);
+	return id;
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include "ResourcePath.hpp"
+#include "ResourcePathMap.hpp"
+
+// the process wide table of interned paths, each distinct normalized path gets a dense id
+// paths are never removed, so ids and the paths they refer to stay valid until the process ends
+// the table owns a copy of each path and an index entry for it, this is on top of the copies kept by maps
+// keyed by ResourcePath, memory is only saved by maps keyed by InternedResourcePath, whose keys are 4 bytes
+class ResourcePathTable
+{
+public:
+	// the table used by InternedResourcePath
+	static ResourcePathTable& Global();
+
+	ResourcePathTable();
+
+	~ResourcePathTable();
+
+	ResourcePathTable(const ResourcePathTable& other) = delete;
+	ResourcePathTable& operator=(const ResourcePathTable& other) = delete;
+
+	// id of the path, it's added if it's not in the table yet, the default path "./" is always 0
+	// throws std::runtime_error if the table is full
+	uint32_t Intern(const ResourcePath& path);
+
+	// the path and its ResourcePathMap hash, without locking, id must have been returned by Intern
+	const ResourcePath& Path(uint32_t id) const
+	{
+		return *EntryAt(id).path;
+	}
+
+	size_t Hash(uint32_t id) const
+	{
+		return EntryAt(id).hash;
+	}
+
+	size_t Size() const
+	{
+		return count.load(std::memory_order_acquire);
+	}
+
+private:
+	struct Entry
+	{
+		// points to the key in the index, so each path is stored once
+		const ResourcePath* path;
+		size_t hash;
+	};
+
+	// chunks are never moved, so an entry is read with two loads and no lock
+	static const uint32_t ChunkBits = 12;
+	static const uint32_t ChunkSize = 1u << ChunkBits;
+	static const uint32_t MaxChunks = 4096;
+
+	std::atomic<Entry*> chunks[MaxChunks] = {};
+	std::atomic<uint32_t> count{ 0 };
+	// guards the index and adding entries
+	std::mutex mutex;
+	ResourcePathMap<uint32_t> index;
+
+	const Entry& EntryAt(uint32_t id) const
+	{
+		return chunks[id >> ChunkBits].load(std::memory_order_acquire)[id & (ChunkSize - 1)];
+	}
+};
+
+// a normalized path reduced to a 32 bit id, copies, comparisons and hashing don't touch the string
+// interning a path takes one lookup in the global table, do it once and keep the result,
+// for example as keys of your own maps or for paths which are compared often
+class InternedResourcePath
+{
+public:
+	// the path "./"
+	InternedResourcePath() : id(0) { }
+
+	explicit InternedResourcePath(const ResourcePath& path) : id(ResourcePathTable::Global().Intern(path)) { }
+
+	uint32_t Id() const { return id; }
+
+	const ResourcePath& Path() const { return ResourcePathTable::Global().Path(id); }
+
+	// same as the ResourcePathMap hash of the path, so it can be passed to Find and Insert
+	size_t Hash() const { return ResourcePathTable::Global().Hash(id); }
+
+	const char* ToCharPtr() const { return Path().ToCharPtr(); }
+
+	bool operator==(const InternedResourcePath& other) const { return id == other.id; }
+	bool operator!=(const InternedResourcePath& other) const { return id != other.id; }
+
+	// orders by id, which is the order in which paths were first interned, not alphabetical
+	bool operator<(const InternedResourcePath& other) const { return id < other.id; }
+
+	// hasher functor value for unordered map
+	class Hasher
+	{
+	public:
+		size_t operator()(const InternedResourcePath& obj) const { return obj.Hash(); }
+	};
+
+private:
+	uint32_t id;
+};
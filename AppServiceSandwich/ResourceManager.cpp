@@ -1,119 +1,1719 @@
 #include "ResourceManager.hpp"
 #include "ResourcePath.hpp"
+#include <algorithm>
+#include <exception>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <unordered_set>
+
+// a factory call running on this thread
+struct FactoryCall
+{
+	const ResourceFactory* factory;
+	const ResourceManager* manager;
+	// the concurrency slot of the call, null if the factory has no limit, see ResourceManager::CallFactory
+	unsigned* activeCalls;
+	unsigned limit;
+	bool holdsSlot;
+};
+
+// factories currently running on this thread, used to let nested Require calls re-enter a factory
+// without waiting for its concurrency limit, otherwise a factory with limit 1 would deadlock on itself
+static thread_local std::vector<FactoryCall> factoriesOnThisThread;
+
+const int ManagedResourceHolder::CompleteQuality;
 
 
-ManagedResourceHolder::ManagedResourceHolder(): reference_count(0), basePtr(nullptr), derivedPtr(nullptr), timestamp(0)
+ManagedResourceHolder::ManagedResourceHolder(): reference_count(0), basePtr(nullptr), derivedPtr(nullptr), timestamp(0), content_hash(0), is_loading(false), generation(0), is_partial(false), quality(CompleteQuality), id(0), profile_session(0), handle_index(0), shared_version(0), stale_manager(nullptr)
 {
 	// don't try this at home, kids!
 }
 
-ManagedResourceHolder::ManagedResourceHolder(ManagedResource* resource, void* derived): reference_count(0),
-                                                                                          basePtr(resource), derivedPtr(derived), timestamp(0)
+ManagedResourceHolder::ManagedResourceHolder(ManagedResource* resource, void* derived): reference_count(0),
+                                                                                          basePtr(resource), derivedPtr(derived), timestamp(0), content_hash(0), is_loading(false), generation(0), is_partial(false), quality(CompleteQuality), id(0), profile_session(0), handle_index(0), shared_version(0), stale_manager(nullptr)
+{
+}
+
+ManagedResourceHolder::ManagedResourceHolder(ManagedResourceHolder&& other) noexcept: reference_count(other.reference_count.load()),
+                                                                                                       basePtr(other.basePtr.load()), derivedPtr(other.derivedPtr.load()), timestamp(other.timestamp), content_hash(other.content_hash),
+                                                                                                       is_loading(other.is_loading), loading_thread(other.loading_thread), generation(other.generation.load()),
+                                                                                                       is_partial(other.is_partial.load()), quality(other.quality.load()), id(other.id.load()), profile_session(other.profile_session), handle_index(other.handle_index), shared_version(other.shared_version), stale_manager(other.stale_manager.load())
+{
+	other.basePtr = nullptr;
+	other.derivedPtr = nullptr;
+}
+
+ManagedResourceHolder& ManagedResourceHolder::operator=(ManagedResourceHolder&& other) noexcept
+{
+	if (this == &other)
+		return *this;
+	reference_count = other.reference_count.load();
+	basePtr = other.basePtr.load();
+	timestamp = other.timestamp;
+	content_hash = other.content_hash;
+	derivedPtr = other.derivedPtr.load();
+	is_loading = other.is_loading;
+	loading_thread = other.loading_thread;
+	generation = other.generation.load();
+	is_partial = other.is_partial.load();
+	quality = other.quality.load();
+	id = other.id.load();
+	profile_session = other.profile_session;
+	handle_index = other.handle_index;
+	shared_version = other.shared_version;
+	stale_manager = other.stale_manager.load();
+	other.basePtr = nullptr;
+	return *this;
+}
+
+void ManagedResourceHolder::RefreshStale()
+{
+	auto manager = stale_manager.load();
+	if (manager != nullptr)
+	{
+		manager->RefreshHolder(*this);
+	}
+}
+
+ManagedResourceHolder::~ManagedResourceHolder()
+{
+	id = 0;
+	if (basePtr != nullptr)
+	{
+		delete basePtr;
+		basePtr = nullptr;
+		derivedPtr = nullptr;
+	}
+}
+
+size_t ResourceFactory::GetMemoryUsage(const ManagedResource& resource)
+{
+	return resource.GetMemoryUsage();
+}
+
+ManagedResource* FlatResourceFactory::operator()(const ResourcePath& resourcePath, ResourceManagerLocation& resourceManager)
+{
+	auto bytes = std::make_shared<std::string>(BuildFlat(resourcePath, resourceManager));
+	return FromFlat(resourcePath, ResourceData(bytes->data(), bytes->size(), bytes));
+}
+
+void ResourceList::Write(std::ostream& out) const
+{
+	for (auto& entry : entries)
+	{
+		out << entry.type << '\t' << entry.path.ToString() << '\n';
+	}
+}
+
+void ResourceList::Read(std::istream& in)
+{
+	std::string line;
+	while (std::getline(in, line))
+	{
+		auto separator = line.find('\t');
+		if (separator == std::string::npos)
+		{
+			continue;
+		}
+		Add(line.substr(0, separator), ResourcePath(line.substr(separator + 1)));
+	}
+}
+
+void ResourceList::Save(const std::string& fileName) const
+{
+	std::ofstream out(fileName, std::ios::trunc);
+	if (!out)
+	{
+		throw std::runtime_error("Can't write resource list: " + fileName);
+	}
+	Write(out);
+}
+
+void ResourceList::Load(const std::string& fileName)
+{
+	std::ifstream in(fileName);
+	if (!in)
+	{
+		throw std::runtime_error("Can't read resource list: " + fileName);
+	}
+	Read(in);
+}
+
+double ResourceTypeStatistics::HitRatio() const
+{
+	auto total = hits + misses;
+	return total == 0 ? 0.0 : static_cast<double>(hits) / total;
+}
+
+ResourceManager::ManagedResourceType::ManagedResourceType(): name(""), factory(nullptr), activeFactoryCalls(0)
+{
+}
+
+ResourceManager::ManagedResourceType::ManagedResourceType(const std::string& name, ResourceFactory& factory): name(name), factory(&factory), activeFactoryCalls(0)
+{
+	statistics.name = name;
+}
+
+static ManagedResource* BuildResource(ResourceFactory& factory, const ResourcePath& resource_path, ResourceManagerLocation& location, ManagedResource* existing)
+{
+	if (existing != nullptr && factory.ReloadInPlace(resource_path, location, *existing))
+	{
+		return existing;
+	}
+	return factory(resource_path, location);
+}
+
+void ResourceManager::CallFactory(ResourceManager::ManagedResourceType& type, const ResourcePath& resource_path, ManagedResourceHolder* holder, ManagedResource*& resource, ManagedResource* existing)
+{
+	// wait for a free slot, unless the same factory is already running on this thread and holds its slot
+	unsigned limit = type.factory->MaxConcurrency();
+	bool reentrant = std::find_if(factoriesOnThisThread.begin(), factoriesOnThisThread.end(),
+		[&type](const FactoryCall& call) { return call.factory == type.factory && call.holdsSlot; }) != factoriesOnThisThread.end();
+	bool gated = limit > 0 && !reentrant;
+	factoriesOnThisThread.push_back(FactoryCall{ type.factory, this, gated ? &type.activeFactoryCalls : nullptr, limit, false });
+	if (gated)
+	{
+		AcquireFactorySlot();
+	}
+
+	if (verboseLoading && consoleInstance != nullptr)
+	{
+		consoleInstance->Open().Output << "resman: load " << type.name << " " << resource_path.ToString() << "\n";
+	}
+	ResourceManagerLocation location;
+	location.resourceManager = this;
+	location.resourcePath = &resource_path;
+	location.holder = holder;
+	bool shared = false;
+	auto flat = sharedCache != nullptr ? dynamic_cast<FlatResourceFactory*>(type.factory) : nullptr;
+	auto build = [&]
+	{
+		return flat != nullptr
+			? BuildShared(type, *flat, resource_path, location, holder, shared)
+			: BuildResource(*type.factory, resource_path, location, existing);
+	};
+	std::exception_ptr failure = nullptr;
+	auto start = std::chrono::steady_clock::now();
+	if (tryCatchFactory)
+	{
+		try
+		{
+			resource = build();
+		}
+		catch (std::logic_error error)
+		{
+			if (consoleInstance != nullptr) consoleInstance->Open().Error << error.what() << "\n";
+			resource = nullptr;
+		}
+		catch (...)
+		{
+			failure = std::current_exception();
+		}
+	}
+	else
+	{
+		try
+		{
+			resource = build();
+		}
+		catch (...)
+		{
+			failure = std::current_exception();
+		}
+	}
+
+	auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+	size_t bucket = 0;
+	while (bucket + 1 < ResourceTypeStatistics::LatencyBucketCount && (1ll << bucket) <= microseconds)
+	{
+		bucket++;
+	}
+
+	// release the slot
+	ReleaseFactorySlot();
+	factoriesOnThisThread.pop_back();
+	{
+		std::lock_guard<std::mutex> guard(containerMutex);
+		type.statistics.factoryMicroseconds += microseconds;
+		if (shared)
+		{
+			type.statistics.sharedHits++;
+		}
+		type.statistics.latencyHistogram[bucket]++;
+	}
+	if (failure != nullptr)
+	{
+		std::rethrow_exception(failure);
+	}
+}
+
+bool ResourceManager::ReleaseFactorySlot()
+{
+	if (factoriesOnThisThread.empty())
+	{
+		return false;
+	}
+	auto& call = factoriesOnThisThread.back();
+	if (call.manager != this || !call.holdsSlot)
+	{
+		return false;
+	}
+	{
+		std::lock_guard<std::mutex> guard(containerMutex);
+		(*call.activeCalls)--;
+		call.holdsSlot = false;
+	}
+	containerChanged.notify_all();
+	return true;
+}
+
+void ResourceManager::AcquireFactorySlot()
+{
+	auto& call = factoriesOnThisThread.back();
+	std::unique_lock<std::mutex> guard(containerMutex);
+	containerChanged.wait(guard, [&call] { return *call.activeCalls < call.limit; });
+	(*call.activeCalls)++;
+	call.holdsSlot = true;
+}
+
+ManagedResource* ResourceManager::BuildShared(ManagedResourceType& type, FlatResourceFactory& factory, const ResourcePath& resource_path,
+	ResourceManagerLocation& location, ManagedResourceHolder* holder, bool& shared)
+{
+	// the holder is reserved by this thread, so its shared_version can be used without the lock
+	bool reload = holder != nullptr && holder->generation > 0;
+	uint64_t seen = 0;
+	if (!sharedCache->IsWritable() || !reload)
+	{
+		// when reloading, only a newer version has the change, otherwise the writing process didn't store it yet
+		uint64_t version = 0;
+		auto data = sharedCache->Find(type.name, resource_path, version);
+		seen = version;
+		if (!data.IsNull() && !(reload && version <= holder->shared_version))
+		{
+			shared = true;
+			if (holder != nullptr)
+			{
+				holder->shared_version = version;
+			}
+			return factory.FromFlat(resource_path, data);
+		}
+	}
+
+	auto bytes = factory.BuildFlat(resource_path, location);
+	uint64_t version;
+	auto data = sharedCache->Store(type.name, resource_path, bytes, version);
+	if (!data.IsNull())
+	{
+		if (holder != nullptr)
+		{
+			holder->shared_version = version;
+		}
+		return factory.FromFlat(resource_path, data);
+	}
+
+	// read only or full, keep a private copy, it's newer than the version which was seen in the cache
+	if (holder != nullptr)
+	{
+		holder->shared_version = seen;
+	}
+	auto copy = std::make_shared<std::string>(std::move(bytes));
+	return factory.FromFlat(resource_path, ResourceData(copy->data(), copy->size(), copy));
+}
+
+ResourceManager::ManagedResourceType& ResourceManager::GetType(const std::string& typeName)
+{
+	auto typeSearch = container.find(typeName);
+	if (typeSearch == container.end()) {
+		throw std::runtime_error("No factory registered for " + typeName);
+	}
+	return typeSearch->second;
+}
+
+// a holder whose queued load was cancelled, nothing was published and nobody is loading it
+// it's loaded like a missing one the next time it's required, but keeps its id so weak pointers stay valid
+static bool IsNeverLoaded(const ManagedResourceHolder& holder)
+{
+	return !holder.is_loading && holder.generation == 0;
+}
+
+ManagedResourceHolder* ResourceManager::RequireHolder(const std::string& typeName, const ResourcePath& key)
+{
+	return RequireHolder(typeName, key, ResourcePathMap<ManagedResourceHolder>::Hash(key));
+}
+
+ManagedResourceHolder* ResourceManager::RequireHolder(const std::string& typeName, const ResourcePath& key, size_t hash)
+{
+	std::unique_lock<std::mutex> guard(containerMutex);
+
+	// get type container
+	ManagedResourceType& type = GetType(typeName);
+
+	// reuse existing, if it's being loaded by other thread then wait for it, or at least for its first partial version
+	auto searchResult = type.loaded.Find(key, hash);
+	while (searchResult != nullptr && searchResult->value.is_loading && searchResult->value.generation == 0)
+	{
+		// queued for the loader threads but not picked up yet, no point waiting for it, load it here
+		if (RemoveQueuedLoad(searchResult))
+		{
+			type.statistics.hits++;
+			RecordRequire(type, *searchResult);
+			searchResult->value.loading_thread = std::this_thread::get_id();
+			searchResult->value.reference_count++;
+			guard.unlock();
+			LoadHolder(type, *searchResult, true);
+			return &(searchResult->value);
+		}
+		if (searchResult->value.loading_thread == std::this_thread::get_id())
+		{
+			throw std::runtime_error("Circular dependency, resource requires itself while loading: " + key.ToString());
+		}
+		containerChanged.wait(guard);
+		// the load might have failed and the holder removed, so search again
+		searchResult = type.loaded.Find(key, hash);
+	}
+	if (searchResult != nullptr && !IsNeverLoaded(searchResult->value))
+	{
+		type.statistics.hits++;
+		RecordRequire(type, *searchResult);
+		searchResult->value.reference_count++;
+		return &(searchResult->value);
+	}
+	type.statistics.misses++;
+	type.statistics.loads++;
+
+	// not found, reserve a holder so that other threads requiring the same resource wait for this load
+	auto inserted = InsertHolder(type, key, hash);
+	auto entry = inserted.first;
+	if (inserted.second)
+	{
+		entry->value.id = ++lastHolderId;
+	}
+	entry->value.is_loading = true;
+	entry->value.loading_thread = std::this_thread::get_id();
+	entry->value.reference_count++;
+	RecordRequire(type, *entry);
+	guard.unlock();
+
+	// build, the container is unlocked so the factory can require other resources
+	LoadHolder(type, *entry, true);
+	return &entry->value;
+}
+
+ManagedResourceHolder* ResourceManager::RequireHolderAsync(const std::string& typeName, const ResourcePath& key, LoadPriority priority)
+{
+	std::unique_lock<std::mutex> guard(containerMutex);
+	ManagedResourceType& type = GetType(typeName);
+
+	size_t hash = ResourcePathMap<ManagedResourceHolder>::Hash(key);
+	auto searchResult = type.loaded.Find(key, hash);
+	if (searchResult != nullptr && !IsNeverLoaded(searchResult->value))
+	{
+		type.statistics.hits++;
+		RecordRequire(type, *searchResult);
+		// still queued, move it up if it was queued with lower priority
+		for (size_t i = static_cast<size_t>(priority) + 1; i < PriorityCount; i++)
+		{
+			auto& queue = asyncQueues[i];
+			auto queued = std::find_if(queue.begin(), queue.end(), [&](const AsyncLoad& load) { return load.entry == searchResult; });
+			if (queued != queue.end())
+			{
+				auto load = *queued;
+				queue.erase(queued);
+				asyncQueues[static_cast<size_t>(priority)].push_back(load);
+				break;
+			}
+		}
+		searchResult->value.reference_count++;
+		return &(searchResult->value);
+	}
+
+	auto entry = QueueLoad(type, key, hash, priority);
+	entry->value.reference_count++;
+	RecordRequire(type, *entry);
+	guard.unlock();
+	containerChanged.notify_all();
+	return &entry->value;
+}
+
+ResourcePathMap<ManagedResourceHolder>::Entry* ResourceManager::QueueLoad(ManagedResourceType& type, const ResourcePath& key, size_t hash, LoadPriority priority)
+{
+	type.statistics.misses++;
+	type.statistics.loads++;
+
+	// reserve the holder and queue it, the loader thread sets loading_thread when it picks it up
+	auto inserted = InsertHolder(type, key, hash);
+	auto entry = inserted.first;
+	if (inserted.second)
+	{
+		entry->value.id = ++lastHolderId;
+	}
+	entry->value.is_loading = true;
+	entry->value.loading_thread = std::thread::id();
+	asyncQueues[static_cast<size_t>(priority)].push_back(AsyncLoad{ &type, entry });
+	if (asyncThreads.size() < asyncThreadCount)
+	{
+		stopAsyncThread = false;
+		asyncThreads.push_back(std::thread([this] { AsyncLoadLoop(); }));
+	}
+	return entry;
+}
+
+std::pair<ResourcePathMap<ManagedResourceHolder>::Entry*, bool> ResourceManager::InsertHolder(ManagedResourceType& type, const ResourcePath& key, size_t hash)
+{
+	auto inserted = type.loaded.Insert(key, hash);
+	if (inserted.second)
+	{
+		loadedPaths.Insert(key).first->value.holders++;
+	}
+	return inserted;
+}
+
+void ResourceManager::AddInlinePath(const ResourcePath& key)
+{
+	std::lock_guard<std::mutex> guard(containerMutex);
+	loadedPaths.Insert(key).first->value.inlined = true;
+}
+
+void ResourceManager::EraseHolder(ManagedResourceType& type, ResourcePathMap<ManagedResourceHolder>::Entry* entry)
+{
+	auto index = entry->value.handle_index;
+	if (index != 0)
+	{
+		auto& slot = handleChunks[index >> HandleChunkBits].load()[index & (HandleChunkSize - 1)];
+		// a new generation invalidates all handles to the slot, 0 is skipped because it means null
+		auto generation = slot.generation.load() + 1;
+		slot.generation = generation == 0 ? 1 : generation;
+		slot.holder = nullptr;
+		freeHandles.push_back(index);
+	}
+	if (entry->value.stale_manager.load() != nullptr)
+	{
+		staleHolders.erase(&entry->value);
+	}
+	if (!pendingReloads.empty())
+	{
+		pendingReloads.erase(&entry->value);
+	}
+	auto loadedPath = loadedPaths.Find(entry->key);
+	if (--loadedPath->value.holders == 0 && !loadedPath->value.inlined)
+	{
+		loadedPaths.Erase(entry->key);
+	}
+	type.loaded.Erase(entry);
+}
+
+uint32_t ResourceManager::AcquireHandle(ManagedResourceHolder* holder, uint32_t& generation)
+{
+	std::lock_guard<std::mutex> guard(containerMutex);
+	auto index = holder->handle_index;
+	if (index == 0)
+	{
+		if (freeHandles.size() > 0)
+		{
+			index = freeHandles.back();
+			freeHandles.pop_back();
+		}
+		else
+		{
+			index = handleCount.load();
+			if (index >> HandleChunkBits >= MaxHandleChunks)
+			{
+				throw std::runtime_error("Too many resource handles");
+			}
+			auto& chunk = handleChunks[index >> HandleChunkBits];
+			if (chunk.load() == nullptr)
+			{
+				chunk = new HandleSlot[HandleChunkSize];
+			}
+		}
+		handleChunks[index >> HandleChunkBits].load()[index & (HandleChunkSize - 1)].holder = holder;
+		holder->handle_index = index;
+		// the slot is ready before the count includes it, so resolving never sees a missing chunk
+		if (index >= handleCount.load())
+		{
+			handleCount = index + 1;
+		}
+	}
+	generation = handleChunks[index >> HandleChunkBits].load()[index & (HandleChunkSize - 1)].generation;
+	return index;
+}
+
+void ResourceManager::RecordRequire(ManagedResourceType& type, ResourcePathMap<ManagedResourceHolder>::Entry& entry)
+{
+	if (recordingProfile && entry.value.profile_session != profileSession)
+	{
+		entry.value.profile_session = profileSession;
+		recordedProfile.Add(type.name, entry.key);
+	}
+}
+
+void ResourceManager::StartProfileRecording()
+{
+	std::lock_guard<std::mutex> guard(containerMutex);
+	recordingProfile = true;
+	profileSession++;
+	recordedProfile.entries.clear();
+}
+
+ResourceList ResourceManager::StopProfileRecording()
+{
+	std::lock_guard<std::mutex> guard(containerMutex);
+	recordingProfile = false;
+	ResourceList profile;
+	std::swap(profile, recordedProfile);
+	return profile;
+}
+
+size_t ResourceManager::PrefetchProfile(const ResourceList& profile, LoadPriority priority)
+{
+	size_t queued = 0;
+	{
+		std::lock_guard<std::mutex> guard(containerMutex);
+		for (auto& item : profile.entries)
+		{
+			auto typeSearch = container.find(item.type);
+			if (typeSearch == container.end())
+			{
+				continue;
+			}
+			auto& type = typeSearch->second;
+			size_t hash = ResourcePathMap<ManagedResourceHolder>::Hash(item.path);
+			auto entry = type.loaded.Find(item.path, hash);
+			if (entry == nullptr || IsNeverLoaded(entry->value))
+			{
+				QueueLoad(type, item.path, hash, priority);
+				queued++;
+			}
+		}
+	}
+	containerChanged.notify_all();
+	return queued;
+}
+
+bool ResourceManager::RemoveQueuedLoad(ResourcePathMap<ManagedResourceHolder>::Entry* entry)
+{
+	for (auto& queue : asyncQueues)
+	{
+		auto queued = std::find_if(queue.begin(), queue.end(), [&](const AsyncLoad& load) { return load.entry == entry; });
+		if (queued != queue.end())
+		{
+			queue.erase(queued);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ResourceManager::CancelQueuedLoad(const std::string& typeName, const ResourcePath& key)
+{
+	std::unique_lock<std::mutex> guard(containerMutex);
+	ManagedResourceType& type = GetType(typeName);
+	auto entry = type.loaded.Find(key);
+	if (entry == nullptr || !RemoveQueuedLoad(entry))
+	{
+		return false;
+	}
+	if (entry->value.reference_count == 0)
+	{
+		EraseHolder(type, entry);
+		guard.unlock();
+		containerChanged.notify_all();
+	}
+	else
+	{
+		// somebody points to it, leave it as if it was never required, so the next Require loads it
+		entry->value.is_loading = false;
+		entry->value.loading_thread = std::thread::id();
+		guard.unlock();
+		containerChanged.notify_all();
+	}
+	return true;
+}
+
+void ResourceManager::SetAsyncThreadCount(unsigned count)
+{
+	std::lock_guard<std::mutex> guard(containerMutex);
+	asyncThreadCount = count > 0 ? count : 1;
+}
+
+void ResourceManager::AsyncLoadLoop()
+{
+	std::unique_lock<std::mutex> guard(containerMutex);
+	while (!stopAsyncThread)
+	{
+		// the queue with highest priority which has something in it
+		std::deque<AsyncLoad>* queue = nullptr;
+		for (auto& candidate : asyncQueues)
+		{
+			if (candidate.size() > 0)
+			{
+				queue = &candidate;
+				break;
+			}
+		}
+		if (queue == nullptr)
+		{
+			containerChanged.wait(guard);
+			continue;
+		}
+		AsyncLoad load = queue->front();
+		queue->pop_front();
+		load.entry->value.loading_thread = std::this_thread::get_id();
+		guard.unlock();
+		try
+		{
+			LoadHolder(*load.type, *load.entry);
+		}
+		catch (std::exception& error)
+		{
+			if (consoleInstance != nullptr) consoleInstance->Open().Error << "resman: async load failed: " << error.what() << "\n";
+		}
+		catch (...)
+		{
+			if (consoleInstance != nullptr) consoleInstance->Open().Error << "resman: async load failed\n";
+		}
+		guard.lock();
+	}
+}
+
+void ResourceManager::LoadHolder(ManagedResourceType& type, ResourcePathMap<ManagedResourceHolder>::Entry& entry, bool referenced)
+{
+	// nobody reads the hash while the holder is loading
+	if (contentHashingService != nullptr)
+	{
+		entry.value.content_hash = contentHashingService->GetFileContentHash(entry.key);
+	}
+
+	ManagedResource* resource_raw_ptr;
+	try
+	{
+		CallFactory(type, entry.key, &entry.value, resource_raw_ptr);
+	}
+	catch (...)
+	{
+		std::unique_lock<std::mutex> guard(containerMutex);
+		if (referenced)
+		{
+			entry.value.reference_count--;
+		}
+		if (entry.value.reference_count == 0)
+		{
+			// nobody points to it, so forget it and let the next Require try again
+			EraseHolder(type, &entry);
+			guard.unlock();
+			containerChanged.notify_all();
+		}
+		else
+		{
+			guard.unlock();
+			PublishResource(entry.value, entry.key, nullptr);
+		}
+		throw;
+	}
+
+	// publish freshly loaded
+	PublishResource(entry.value, entry.key, resource_raw_ptr);
+}
+
+void ResourceManager::PublishResource(ManagedResourceHolder& holder, const ResourcePath& resource_path, ManagedResource* resource, bool partial, int quality)
+{
+	// inject helper variables
+	if (resource != nullptr)
+	{
+		resource->resourceManager.resourceManager = this;
+		resource->resourceManager.resourcePath = &resource_path;
+	}
+
+	ManagedResource* previous;
+	StaleHolder pending;
+	bool reload = false;
+	{
+		std::lock_guard<std::mutex> guard(containerMutex);
+		previous = holder.basePtr;
+		holder.basePtr = resource;
+		holder.derivedPtr = nullptr;
+		holder.is_partial = partial;
+		holder.quality = partial ? quality : ManagedResourceHolder::CompleteQuality;
+		if (!partial)
+		{
+			reload = TakePendingReload(holder, pending);
+			holder.is_loading = reload;
+		}
+		if (holder.generation++ > 0)
+		{
+			reloadEpoch++;
+		}
+		// the previous version can't be reached through the holder anymore, but other threads may still use it
+		if (previous != nullptr && previous != resource)
+		{
+			retiredResources.push_back(previous);
+		}
+	}
+	containerChanged.notify_all();
+	if (reload)
+	{
+		RunPendingReload(pending);
+	}
+}
+
+void ResourceManager::Preload(const ResourceList& list, unsigned threadCount)
+{
+	auto& entries = list.entries;
+	if (entries.size() == 0)
+	{
+		return;
+	}
+	if (threadCount == 0)
+	{
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+	threadCount = static_cast<unsigned>(std::min<size_t>(threadCount, entries.size()));
+
+	// entries not yet picked up by any worker, guarded by containerMutex
+	std::vector<size_t> pending(entries.size());
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		pending[i] = i;
+	}
+	size_t completed = 0;
+	std::exception_ptr firstError = nullptr;
+
+	auto worker = [&]()
+	{
+		std::unique_lock<std::mutex> guard(containerMutex);
+		while (pending.size() > 0)
+		{
+			// pick the first entry which is loaded already or whose factory has a free slot
+			// so that workers don't sit blocked behind a busy factory while other work is available
+			auto pick = pending.end();
+			for (auto i = pending.begin(); i != pending.end(); ++i)
+			{
+				auto& entry = entries[*i];
+				auto typeSearch = container.find(entry.type);
+				if (typeSearch == container.end())
+				{
+					pick = i; // RequireHolder will report the error
+					break;
+				}
+				auto& type = typeSearch->second;
+				unsigned limit = type.factory->MaxConcurrency();
+				if (limit == 0 || type.activeFactoryCalls < limit || type.loaded.Find(entry.path) != nullptr)
+				{
+					pick = i;
+					break;
+				}
+			}
+			if (pick == pending.end())
+			{
+				containerChanged.wait(guard);
+				continue;
+			}
+			auto& entry = entries[*pick];
+			pending.erase(pick);
+			guard.unlock();
+
+			try
+			{
+				// only loaded here, the caller requires it again to keep it
+				RequireHolder(entry.type, entry.path)->reference_count--;
+			}
+			catch (...)
+			{
+				guard.lock();
+				if (firstError == nullptr) firstError = std::current_exception();
+				guard.unlock();
+			}
+
+			guard.lock();
+			completed++;
+			size_t done = completed;
+			guard.unlock();
+			ReportPreloadProgress(done, entries.size());
+			guard.lock();
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (unsigned i = 0; i < threadCount; i++)
+	{
+		workers.emplace_back(worker);
+	}
+	for (auto& thread : workers)
+	{
+		thread.join();
+	}
+	if (firstError != nullptr)
+	{
+		std::rethrow_exception(firstError);
+	}
+}
+
+void ResourceManager::ReportPreloadProgress(size_t completed, size_t total)
+{
+	if (consoleInstance == nullptr)
+	{
+		return;
+	}
+	// only print when the percentage changes, thousands of console writes would slow down the preload
+	size_t percent = completed * 100 / total;
+	if (completed != total && percent == (completed - 1) * 100 / total)
+	{
+		return;
+	}
+	consoleInstance->ProgressPrinter(this).Output << "resman: preload " << completed << "/" << total << " (" << percent << "%)";
+}
+
+void ResourceManager::ReleaseHolder(ManagedResourceHolder& holder)
+{
+	StaleHolder pending;
+	bool reload;
+	{
+		std::lock_guard<std::mutex> guard(containerMutex);
+		reload = TakePendingReload(holder, pending);
+		holder.is_loading = reload;
+	}
+	containerChanged.notify_all();
+	if (reload)
+	{
+		RunPendingReload(pending);
+	}
+}
+
+bool ResourceManager::TakePendingReload(ManagedResourceHolder& holder, StaleHolder& pending)
+{
+	if (pendingReloads.empty())
+	{
+		return false;
+	}
+	auto found = pendingReloads.find(&holder);
+	if (found == pendingReloads.end())
+	{
+		return false;
+	}
+	pending = found->second;
+	pendingReloads.erase(found);
+	holder.loading_thread = std::this_thread::get_id();
+	return true;
+}
+
+void ResourceManager::RunPendingReload(const StaleHolder& pending)
+{
+	// the load which finished was successful, so a failure of the reload is not thrown to its caller
+	ChangedFile file;
+	try
+	{
+		ReloadHolder(*pending.type, pending.entry->key, pending.entry->value, pending.entry->value.content_hash, file);
+	}
+	catch (std::exception& error)
+	{
+		if (consoleInstance != nullptr) consoleInstance->Open().Error << "resman: reload failed: " << error.what() << "\n";
+	}
+	catch (...)
+	{
+		if (consoleInstance != nullptr) consoleInstance->Open().Error << "resman: reload failed\n";
+	}
+}
+
+void ResourceManager::ReloadHolder(ManagedResourceType& type, const ResourcePath& resource_path, ManagedResourceHolder& holder, unsigned long long content_hash, ChangedFile& file)
+{
+	try
+	{
+		if (this->timestampingService != nullptr && file.timestampQueried == false)
+		{
+			file.timestamp = this->timestampingService->GetFileTimestamp(resource_path);
+			file.timestampQueried = true;
+		}
+		// reload if file is newer or no information available
+		if (file.timestamp > 0 && file.timestamp < holder.timestamp)
+		{
+			ReleaseHolder(holder);
+			return;
+		}
+		// the file was touched but the contents are the same, don't rebuild
+		if (this->contentHashingService != nullptr && file.contentHashQueried == false)
+		{
+			file.contentHash = this->contentHashingService->GetFileContentHash(resource_path);
+			file.contentHashQueried = true;
+		}
+		if (file.contentHash != 0 && file.contentHash == content_hash)
+		{
+			{
+				std::lock_guard<std::mutex> guard(containerMutex);
+				type.statistics.skippedReloads++;
+				holder.timestamp = file.timestamp;
+			}
+			ReleaseHolder(holder);
+			return;
+		}
+		ManagedResource* existing = holder.basePtr;
+		ManagedResource* resource;
+		CallFactory(type, resource_path, &holder, resource, existing);
+		{
+			std::lock_guard<std::mutex> guard(containerMutex);
+			type.statistics.reloads++;
+			if (resource != nullptr && resource == existing)
+			{
+				type.statistics.inPlaceReloads++;
+			}
+			holder.timestamp = file.timestamp;
+			holder.content_hash = file.contentHash;
+		}
+		PublishResource(holder, resource_path, resource);
+	}
+	catch (...)
+	{
+		// the holder keeps its published version
+		{
+			std::lock_guard<std::mutex> guard(containerMutex);
+			type.statistics.failedReloads++;
+		}
+		ReleaseHolder(holder);
+		throw;
+	}
+}
+
+void ResourceManager::RefreshHolder(ManagedResourceHolder& holder)
+{
+	ManagedResourceType* type;
+	ResourcePathMap<ManagedResourceHolder>::Entry* entry;
+	{
+		std::lock_guard<std::mutex> guard(containerMutex);
+		auto found = staleHolders.find(&holder);
+		// another thread refreshed it already
+		if (found == staleHolders.end())
+		{
+			return;
+		}
+		// while another reload runs the current version is used, it stays stale and is refreshed on a later access
+		// waiting here could deadlock, the factory building it might require a resource which this thread is building
+		if (holder.is_loading)
+		{
+			return;
+		}
+		type = found->second.type;
+		entry = found->second.entry;
+		staleHolders.erase(found);
+		holder.stale_manager = nullptr;
+		holder.is_loading = true;
+		holder.loading_thread = std::this_thread::get_id();
+	}
+	// called from a pointer dereference, which must not throw, the previous version is kept and the change is dropped
+	// marking it stale again would call the failing factory on every access
+	ChangedFile file;
+	try
+	{
+		ReloadHolder(*type, entry->key, holder, holder.content_hash, file);
+	}
+	catch (std::exception& error)
+	{
+		if (consoleInstance != nullptr) consoleInstance->Open().Error << "resman: lazy reload failed: " << error.what() << "\n";
+	}
+	catch (...)
+	{
+		if (consoleInstance != nullptr) consoleInstance->Open().Error << "resman: lazy reload failed\n";
+	}
+}
+
+void ResourceManager::SetReloadPolicy(ReloadPolicy policy)
+{
+	std::lock_guard<std::mutex> guard(containerMutex);
+	reloadPolicy = policy;
+}
+
+void ResourceManager::SetRetirePolicy(RetirePolicy policy)
+{
+	std::lock_guard<std::mutex> guard(containerMutex);
+	retirePolicy = policy;
+}
+
+void ResourceManager::NotifyResourceChange(const ResourcePath& path)
+{
+	ReleaseRetiredOnChange();
+	ReloadChangedPath(path);
+}
+
+void ResourceManager::ReloadChangedPath(const ResourcePath& path)
+{
+	// the file might have been created or deleted, so where it was found is no longer known
+	fileSystem.Invalidate(path);
+
+	// find matching holders, the factory can't be called while the container is locked
+	struct Match
+	{
+		ManagedResourceType* type;
+		const ResourcePath* resource_path;
+		ManagedResourceHolder* resource_holder;
+		unsigned long long content_hash;
+	};
+	std::vector<Match> matches;
+	// resources dropped by a lazy reload, deleted after the lock is released
+	std::vector<ManagedResource*> garbage;
+	{
+		std::lock_guard<std::mutex> guard(containerMutex);
+		size_t hash = ResourcePathMap<ManagedResourceHolder>::Hash(path);
+		for (auto i = this->container.begin(); i != this->container.end(); ++i)
+		{
+			auto& type = i->second;
+			auto entry = type.loaded.Find(path, hash);
+			if (entry == nullptr)
+			{
+				continue;
+			}
+			if (reloadPolicy == ReloadPolicy::Lazy)
+			{
+				// nothing would see a rebuilt version of an unreferenced one, the others are marked even while loading,
+				// the version being loaded may have been read before the change
+				int expected = 0;
+				if (!entry->value.is_loading && entry->value.reference_count.compare_exchange_strong(expected, -1))
+				{
+					garbage.push_back(entry->value.basePtr.exchange(nullptr));
+					EraseHolder(type, entry);
+				}
+				else if (entry->value.stale_manager.load() == nullptr)
+				{
+					entry->value.stale_manager = this;
+					staleHolders[&entry->value] = StaleHolder{ &type, entry };
+				}
+			}
+			else if (!entry->value.is_loading)
+			{
+				// mark it as loading, so that it's not unloaded or reloaded by another thread meanwhile
+				// Require doesn't wait for it since it already has a published version
+				entry->value.is_loading = true;
+				entry->value.loading_thread = std::this_thread::get_id();
+				matches.push_back(Match{ &type, &entry->key, &entry->value, entry->value.content_hash });
+			}
+			else if (entry->value.loading_thread != std::thread::id())
+			{
+				// the version being loaded may have been read before the change, it's built again once it's published
+				// a queued load which no thread picked up yet reads the changed file anyway
+				pendingReloads[&entry->value] = StaleHolder{ &type, entry };
+			}
+		}
+	}
+	for (auto resource : garbage)
+	{
+		delete resource;
+	}
+
+	ChangedFile file;
+	for (size_t i = 0; i < matches.size(); i++)
+	{
+		auto& match = matches[i];
+		try
+		{
+			ReloadHolder(*match.type, *match.resource_path, *match.resource_holder, match.content_hash, file);
+		}
+		catch (...)
+		{
+			// the remaining holders keep their published version
+			for (size_t j = i + 1; j < matches.size(); j++)
+			{
+				ReleaseHolder(*matches[j].resource_holder);
+			}
+			throw;
+		}
+	}
+
+	// inline resources are written in place, so there is nothing to publish
+	std::vector<InlineResourceTableBase*> tables;
+	{
+		std::lock_guard<std::mutex> guard(containerMutex);
+		for (auto& i : inlineTables)
+		{
+			tables.push_back(i.second.get());
+		}
+	}
+	ResourceManagerLocation location;
+	location.resourceManager = this;
+	location.resourcePath = &path;
+	for (auto table : tables)
+	{
+		if (table->Reload(path, location))
+		{
+			reloadEpoch++;
+		}
+	}
+}
+
+void ResourceManager::NotifyDirectoryChange(const ResourcePath& directory)
+{
+	ReleaseRetiredOnChange();
+
+	// files might have appeared or disappeared anywhere under it, mounts could now resolve differently
+	fileSystem.InvalidateAll();
+
+	std::vector<ResourcePath> paths;
+	{
+		std::lock_guard<std::mutex> guard(containerMutex);
+		loadedPaths.ForEachUnder(directory, [&](ResourcePathTrie<LoadedPath>::Entry& entry) { paths.push_back(entry.key); });
+	}
+	std::exception_ptr failure;
+	for (auto& path : paths)
+	{
+		try
+		{
+			ReloadChangedPath(path);
+		}
+		catch (...)
+		{
+			// a removed directory fails to reload, the other paths are still handled
+			if (failure == nullptr)
+			{
+				failure = std::current_exception();
+			}
+		}
+	}
+	if (failure != nullptr)
+	{
+		std::rethrow_exception(failure);
+	}
+}
+
+void ResourceManager::ScheduleResourceChange(const ResourcePath& path)
+{
+	{
+		std::lock_guard<std::mutex> guard(scheduleMutex);
+		scheduledChanges.Insert(path).first->value = std::chrono::steady_clock::now();
+	}
+	scheduleChanged.notify_all();
+}
+
+void ResourceManager::SetReloadQuietPeriod(long long milliseconds)
+{
+	{
+		std::lock_guard<std::mutex> guard(scheduleMutex);
+		reloadQuietPeriod = std::chrono::milliseconds(milliseconds);
+	}
+	scheduleChanged.notify_all();
+}
+
+size_t ResourceManager::ProcessScheduledReloads()
+{
+	ReleaseRetiredResources();
+	return ReloadScheduledChanges(false);
+}
+
+size_t ResourceManager::ReleaseRetiredResources()
+{
+	std::vector<ManagedResource*> retired;
+	{
+		std::lock_guard<std::mutex> guard(containerMutex);
+		retired.swap(retiredResources);
+	}
+	// deleting may release references to other resources, so it's done without the lock
+	for (auto resource : retired)
+	{
+		delete resource;
+	}
+	return retired.size();
+}
+
+void ResourceManager::ReleaseRetiredOnChange()
+{
+	{
+		std::lock_guard<std::mutex> guard(containerMutex);
+		if (retirePolicy == RetirePolicy::Manual || retiredResources.empty())
+		{
+			return;
+		}
+	}
+	ReleaseRetiredResources();
+}
+
+size_t ResourceManager::FlushScheduledReloads()
+{
+	return ReloadScheduledChanges(true);
+}
+
+size_t ResourceManager::ReloadScheduledChanges(bool all)
+{
+	std::vector<ResourcePath> due;
+	{
+		std::lock_guard<std::mutex> guard(scheduleMutex);
+		auto now = std::chrono::steady_clock::now();
+		for (auto& entry : scheduledChanges)
+		{
+			if (all || now - entry.value >= reloadQuietPeriod)
+			{
+				due.push_back(entry.key);
+			}
+		}
+		for (auto& path : due)
+		{
+			scheduledChanges.Erase(path);
+		}
+	}
+	if (due.size() > 0)
+	{
+		ReleaseRetiredOnChange();
+	}
+	std::exception_ptr failure;
+	for (auto& path : due)
+	{
+		try
+		{
+			ReloadChangedPath(path);
+		}
+		catch (...)
+		{
+			// the paths are no longer scheduled, so the others must be reloaded now or never
+			if (failure == nullptr)
+			{
+				failure = std::current_exception();
+			}
+		}
+	}
+	if (failure != nullptr)
+	{
+		std::rethrow_exception(failure);
+	}
+	return due.size();
+}
+
+void ResourceManager::StartReloadThread()
 {
+	std::lock_guard<std::mutex> guard(scheduleMutex);
+	if (reloadThread.joinable())
+	{
+		return;
+	}
+	stopReloadThread = false;
+	reloadThread = std::thread([this] { ReloadThreadLoop(); });
 }
 
-ManagedResourceHolder::ManagedResourceHolder(ManagedResourceHolder&& other) noexcept: reference_count(other.reference_count),
-                                                                                                       basePtr(other.basePtr), derivedPtr(other.derivedPtr), timestamp(other.timestamp)
+void ResourceManager::StopReloadThread()
 {
-	other.basePtr = nullptr;
-	other.derivedPtr = nullptr;
+	{
+		std::lock_guard<std::mutex> guard(scheduleMutex);
+		stopReloadThread = true;
+	}
+	scheduleChanged.notify_all();
+	if (reloadThread.joinable())
+	{
+		reloadThread.join();
+	}
 }
 
-ManagedResourceHolder& ManagedResourceHolder::operator=(ManagedResourceHolder&& other) noexcept
+void ResourceManager::ReloadThreadLoop()
 {
-	if (this == &other)
-		return *this;
-	reference_count = other.reference_count;
-	basePtr = other.basePtr;
-	timestamp = other.timestamp;
-	derivedPtr = other.derivedPtr;
-	other.basePtr = nullptr;
-	return *this;
+	std::unique_lock<std::mutex> guard(scheduleMutex);
+	while (!stopReloadThread)
+	{
+		if (scheduledChanges.Size() == 0)
+		{
+			scheduleChanged.wait(guard);
+			continue;
+		}
+
+		// sleep until the oldest notification becomes quiet, new notifications only move deadlines later
+		auto deadline = std::chrono::steady_clock::time_point::max();
+		for (auto& entry : scheduledChanges)
+		{
+			deadline = std::min(deadline, entry.value + reloadQuietPeriod);
+		}
+		if (std::chrono::steady_clock::now() < deadline)
+		{
+			scheduleChanged.wait_until(guard, deadline);
+			continue;
+		}
+
+		guard.unlock();
+		try
+		{
+			ReloadScheduledChanges(false);
+		}
+		catch (std::exception& error)
+		{
+			if (consoleInstance != nullptr) consoleInstance->Open().Error << "resman: reload failed: " << error.what() << "\n";
+		}
+		catch (...)
+		{
+			if (consoleInstance != nullptr) consoleInstance->Open().Error << "resman: reload failed\n";
+		}
+		guard.lock();
+	}
 }
 
-ManagedResourceHolder::~ManagedResourceHolder()
+void ResourceManagerLocation::PublishPartial(ManagedResource* resource, int quality)
 {
-	if (basePtr != nullptr)
+	if (holder == nullptr)
 	{
-		delete basePtr;
-		basePtr = nullptr;
-		derivedPtr = nullptr;
+		throw std::logic_error("PublishPartial can only be called by the factory building the resource");
 	}
+	resourceManager->PublishResource(*holder, *resourcePath, resource, true, quality);
 }
 
-ResourceManager::ManagedResourceType::ManagedResourceType(): name(""), factory(nullptr)
+ResourceData ResourceManagerLocation::Read() const
 {
+	return resourceManager->ReadResource(*resourcePath);
 }
 
-ResourceManager::ManagedResourceType::ManagedResourceType(const std::string& name, ResourceFactory& factory): name(name), factory(&factory)
+ResourceData ResourceManagerLocation::Read(const ResourcePath& newLocation) const
 {
+	return resourceManager->ReadResource(resourceManager->resolvedLocations.Resolve(*resourcePath, newLocation).path);
 }
 
-void ResourceManager::CallFactory(ResourceManager::ManagedResourceType& type, const ResourcePath& resource_path, ManagedResource*& resource)
+ResourcePath ResourceManager::ResolveLocation(const ResourcePath& currentLocation, const ResourcePath& newLocation)
 {
-	if (verboseLoading && consoleInstance != nullptr)
+	return ResourcePathResolver::ResolveLocation(currentLocation, newLocation);
+}
+
+// priorities of the loose file mount, below or above mounts with the default priority 0
+static const int LooseFilePriority = -1000;
+static const int LooseFileOverridePriority = 1000;
+
+void ResourceManager::MountPack(const std::string& fileName)
+{
+	MountPack(std::make_shared<ResourcePack>(fileName));
+}
+
+void ResourceManager::MountPack(std::shared_ptr<ResourcePack> pack)
+{
+	fileSystem.Mount(std::make_shared<PackMount>(std::move(pack)));
+}
+
+void ResourceManager::Mount(std::shared_ptr<MountPoint> mount, int priority)
+{
+	fileSystem.Mount(std::move(mount), priority);
+}
+
+bool ResourceManager::Unmount(const std::shared_ptr<MountPoint>& mount)
+{
+	return fileSystem.Unmount(mount);
+}
+
+void ResourceManager::SetLooseFileOverride(bool enabled)
+{
+	// loose files are above or below every mount which uses the default priority
+	fileSystem.Unmount(looseFiles);
+	fileSystem.Mount(looseFiles, enabled ? LooseFileOverridePriority : LooseFilePriority);
+}
+
+ResourceData ResourceManager::ReadResource(const ResourcePath& path)
+{
+	auto data = fileSystem.Read(path);
+	if (data.IsNull())
 	{
-		consoleInstance->Open().Output << "resman: load " << type.name << " " << resource_path.ToString() << "\n";
+		throw std::runtime_error("Resource not found: " + path.ToString());
 	}
-	ResourceManagerLocation location;
-	location.resourceManager = this;
-	location.resourcePath = &resource_path;
-	if (tryCatchFactory)
+	return data;
+}
+
+size_t ResourceManager::CollectUnreferenced()
+{
+	ReleaseRetiredOnChange();
+	size_t total = 0;
+	while (true)
 	{
-		try
+		std::vector<ManagedResource*> garbage;
+		{
+			std::lock_guard<std::mutex> guard(containerMutex);
+			for (auto& i : container)
+			{
+				auto& type = i.second;
+				std::vector<ResourcePathMap<ManagedResourceHolder>::Entry*> unreferenced;
+				for (auto& entry : type.loaded)
+				{
+					// mark it with -1 so that a concurrent WeakResourcePtr::Lock can't take a new reference
+					int expected = 0;
+					if (!entry.value.is_loading && entry.value.reference_count.compare_exchange_strong(expected, -1))
+					{
+						unreferenced.push_back(&entry);
+					}
+				}
+				for (auto entry : unreferenced)
+				{
+					garbage.push_back(entry->value.basePtr.exchange(nullptr));
+					EraseHolder(type, entry);
+				}
+			}
+		}
+		if (garbage.size() == 0)
 		{
-			resource = (*type.factory)(resource_path, location);
+			break;
 		}
-		catch (std::logic_error error)
+		total += garbage.size();
+		// deleting may release references to other resources, those are collected in the next pass
+		for (auto resource : garbage)
 		{
-			if (consoleInstance != nullptr) consoleInstance->Open().Error << error.what() << "\n";
-			resource = nullptr;
+			delete resource;
 		}
 	}
-	else
+	return total;
+}
+
+void ResourceManager::LoadSet(const std::string& name, const ResourceList& list)
+{
+	ResourceSet* set;
+	{
+		std::lock_guard<std::mutex> guard(containerMutex);
+		auto& slot = resourceSets[name];
+		if (slot == nullptr)
+		{
+			slot.reset(new ResourceSet());
+		}
+		set = slot.get();
+	}
+
+	std::vector<ResourceSet::Staged> discarded;
+	while (true)
 	{
-		resource = (*type.factory)(resource_path, location);
+		JoinSetBuilder(*set);
+		std::lock_guard<std::mutex> guard(containerMutex);
+		// another thread started a build of the same set meanwhile, wait for that one too
+		if (set->builder.joinable() || !set->ready)
+		{
+			continue;
+		}
+		discarded = std::move(set->staged);
+		set->staged.clear();
+		set->failure = nullptr;
+		set->ready = false;
+		set->builder = std::thread([this, set, list] { BuildSet(*set, list); });
+		break;
 	}
+	DiscardStaged(discarded);
 }
 
-void ResourceManager::NotifyResourceChange(const ResourcePath& path)
+bool ResourceManager::IsSetReady(const std::string& name)
 {
-	bool fileTimestampQueried = false;
-	long long fileTimestamp = 0;
-	for (auto i = this->container.begin(); i!=this->container.end(); ++i)
+	std::lock_guard<std::mutex> guard(containerMutex);
+	auto found = resourceSets.find(name);
+	return found == resourceSets.end() || found->second->ready;
+}
+
+void ResourceManager::CommitSet(const std::string& name)
+{
+	auto& set = GetSet(name);
+	JoinSetBuilder(set);
+
+	std::vector<ResourceSet::Staged> staged;
+	std::exception_ptr failure;
 	{
-		auto& type = i->second;
-		for (auto j = type.loaded.begin(); j != type.loaded.end(); ++j)
+		std::unique_lock<std::mutex> guard(containerMutex);
+		staged = std::move(set.staged);
+		set.staged.clear();
+		failure = set.failure;
+		set.failure = nullptr;
+		if (failure == nullptr)
 		{
-			auto& resource_path = j->first;
-			auto& resource_holder = j->second;
-			if (resource_path == path)
+			// a holder which is being loaded or reloaded would be overwritten by the loading thread later, wait for it
+			const ResourcePath* loadingHere = nullptr;
+			containerChanged.wait(guard, [&]
 			{
-				// match! reload!
-				if (this->timestampingService != nullptr && fileTimestampQueried == false)
+				for (auto& built : staged)
 				{
-					fileTimestamp = this->timestampingService->GetFileTimestamp(resource_path);
-					fileTimestampQueried = true;
-				}
-				// reload if file is newer or no information available
-				if (fileTimestamp <= 0 || fileTimestamp >= resource_holder.timestamp)
-				{
-					ManagedResource* resource;
-					CallFactory(type, resource_path, resource);
-					resource_holder.basePtr = resource;
-					resource_holder.timestamp = fileTimestamp;
-					resource_holder.derivedPtr = nullptr;
-
-					// inject helper variables
-					if (resource != nullptr)
+					auto entry = built.type->loaded.Find(built.path);
+					if (entry != nullptr && entry->value.is_loading)
 					{
-						resource->resourceManager.resourceManager = this;
-						resource->resourceManager.resourcePath = &(resource_path);
+						if (entry->value.loading_thread == std::this_thread::get_id())
+						{
+							loadingHere = &built.path;
+							return true;
+						}
+						return false;
 					}
 				}
+				return true;
+			});
+			if (loadingHere != nullptr)
+			{
+				auto message = "Resource set contains a resource which is loading on this thread: " + loadingHere->ToString();
+				guard.unlock();
+				DiscardStaged(staged);
+				throw std::runtime_error(message);
+			}
+
+			// everything is published under this lock, so nobody sees a mix of old and new versions
+			std::vector<ResourceSet::Member> members;
+			std::unordered_set<ManagedResourceHolder*> committed;
+			bool reloaded = false;
+			for (auto& built : staged)
+			{
+				auto& type = *built.type;
+				auto inserted = InsertHolder(type, built.path, ResourcePathMap<ManagedResourceHolder>::Hash(built.path));
+				auto entry = inserted.first;
+				auto& holder = entry->value;
+				if (inserted.second)
+				{
+					holder.id = ++lastHolderId;
+					type.statistics.loads++;
+				}
+				else
+				{
+					type.statistics.reloads++;
+				}
+				if (built.resource != nullptr)
+				{
+					built.resource->resourceManager.resourceManager = this;
+					built.resource->resourceManager.resourcePath = &entry->key;
+				}
+				auto previous = holder.basePtr.exchange(built.resource);
+				if (previous != nullptr)
+				{
+					retiredResources.push_back(previous);
+				}
+				built.resource = nullptr;
+				holder.derivedPtr = nullptr;
+				// a change marked by ReloadPolicy::Lazy is overwritten by the committed version
+				if (holder.stale_manager.load() != nullptr)
+				{
+					holder.stale_manager = nullptr;
+					staleHolders.erase(&holder);
+				}
+				holder.is_partial = false;
+				holder.quality = ManagedResourceHolder::CompleteQuality;
+				holder.timestamp = built.timestamp;
+				holder.content_hash = built.content_hash;
+				if (holder.generation++ > 0)
+				{
+					reloaded = true;
+				}
+				if (committed.insert(&holder).second)
+				{
+					holder.reference_count++;
+					members.push_back(ResourceSet::Member{ &type, entry });
+				}
+			}
+			if (reloaded)
+			{
+				reloadEpoch++;
+			}
+			// references of the previous commit are released only now, so resources in both are not unloaded meanwhile
+			for (auto& member : set.members)
+			{
+				member.entry->value.reference_count--;
+			}
+			set.members = std::move(members);
+		}
+	}
+	containerChanged.notify_all();
+
+	DiscardStaged(staged);
+	if (failure != nullptr)
+	{
+		std::rethrow_exception(failure);
+	}
+}
+
+size_t ResourceManager::UnloadSet(const std::string& name)
+{
+	auto& set = GetSet(name);
+	JoinSetBuilder(set);
+
+	std::vector<ResourceSet::Staged> staged;
+	std::vector<ManagedResource*> garbage;
+	{
+		std::lock_guard<std::mutex> guard(containerMutex);
+		staged = std::move(set.staged);
+		set.staged.clear();
+		set.failure = nullptr;
+		for (auto& member : set.members)
+		{
+			auto& holder = member.entry->value;
+			holder.reference_count--;
+			// same as CollectUnreferenced, but only for the members of the set
+			int expected = 0;
+			if (!holder.is_loading && holder.reference_count.compare_exchange_strong(expected, -1))
+			{
+				garbage.push_back(holder.basePtr.exchange(nullptr));
+				EraseHolder(*member.type, member.entry);
+			}
+		}
+		set.members.clear();
+	}
+
+	for (auto resource : garbage)
+	{
+		delete resource;
+	}
+	DiscardStaged(staged);
+	return garbage.size();
+}
+
+ResourceManager::ResourceSet& ResourceManager::GetSet(const std::string& name)
+{
+	std::lock_guard<std::mutex> guard(containerMutex);
+	auto found = resourceSets.find(name);
+	if (found == resourceSets.end())
+	{
+		throw std::runtime_error("Resource set was never loaded: " + name);
+	}
+	return *found->second;
+}
+
+void ResourceManager::BuildSet(ResourceSet& set, ResourceList list)
+{
+	std::vector<ResourceSet::Staged> staged;
+	staged.reserve(list.entries.size());
+	std::exception_ptr failure = nullptr;
+	try
+	{
+		for (auto& entry : list.entries)
+		{
+			ResourceSet::Staged built{ nullptr, entry.path, nullptr, 0, 0 };
+			{
+				std::lock_guard<std::mutex> guard(containerMutex);
+				built.type = &GetType(entry.type);
+			}
+			if (timestampingService != nullptr)
+			{
+				built.timestamp = timestampingService->GetFileTimestamp(entry.path);
 			}
+			if (contentHashingService != nullptr)
+			{
+				built.content_hash = contentHashingService->GetFileContentHash(entry.path);
+			}
+			// there is no holder yet, so the factory can't publish partial versions, only the complete one is committed
+			CallFactory(*built.type, built.path, nullptr, built.resource);
+			staged.push_back(std::move(built));
 		}
 	}
+	catch (...)
+	{
+		failure = std::current_exception();
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(containerMutex);
+		set.staged = std::move(staged);
+		set.failure = failure;
+		set.ready = true;
+	}
+	containerChanged.notify_all();
+}
+
+void ResourceManager::JoinSetBuilder(ResourceSet& set)
+{
+	std::thread builder;
+	{
+		std::lock_guard<std::mutex> guard(containerMutex);
+		builder = std::move(set.builder);
+	}
+	if (builder.joinable())
+	{
+		builder.join();
+	}
+	// another thread might have taken the builder to join it
+	std::unique_lock<std::mutex> guard(containerMutex);
+	containerChanged.wait(guard, [&set] { return set.ready.load(); });
+}
+
+void ResourceManager::DiscardStaged(std::vector<ResourceSet::Staged>& staged)
+{
+	for (auto& built : staged)
+	{
+		delete built.resource;
+	}
+	staged.clear();
+}
+
+unsigned long long ResourceManager::GetReloadEpoch() const
+{
+	return reloadEpoch;
 }
 
 void ResourceManager::UseTimestampingService(ITimestampingService* service)
@@ -121,6 +1721,16 @@ void ResourceManager::UseTimestampingService(ITimestampingService* service)
 	this->timestampingService = service;
 }
 
+void ResourceManager::UseContentHashingService(IContentHashingService* service)
+{
+	this->contentHashingService = service;
+}
+
+void ResourceManager::UseSharedCache(std::shared_ptr<SharedResourceCache> cache)
+{
+	this->sharedCache = std::move(cache);
+}
+
 void ResourceManager::UseConsole(Console* console)
 {
 	this->consoleInstance = console;
@@ -136,34 +1746,177 @@ void ResourceManager::SetVerboseLoading(bool verbose)
 	verboseLoading = verbose;
 }
 
+std::vector<ResourceTypeStatistics> ResourceManager::GetStatistics()
+{
+	std::lock_guard<std::mutex> guard(containerMutex);
+	std::vector<ResourceTypeStatistics> result;
+	for (auto& i : container)
+	{
+		auto& type = i.second;
+		ResourceTypeStatistics statistics = type.statistics;
+		for (auto& entry : type.loaded)
+		{
+			auto& holder = entry.value;
+			if (holder.basePtr != nullptr)
+			{
+				statistics.loaded++;
+				statistics.memoryUsage += type.factory->GetMemoryUsage(*holder.basePtr);
+			}
+			if (holder.reference_count > 0)
+			{
+				statistics.referenced++;
+			}
+			else
+			{
+				statistics.unreferenced++;
+			}
+		}
+		result.push_back(statistics);
+	}
+	return result;
+}
+
+// escape characters which can't appear in a JSON string
+static void WriteJsonString(std::ostream& out, const std::string& value)
+{
+	out << '"';
+	for (char c : value)
+	{
+		if (c == '"' || c == '\\') out << '\\' << c;
+		else if (static_cast<unsigned char>(c) < 0x20) out << ' ';
+		else out << c;
+	}
+	out << '"';
+}
+
+std::string ResourceManager::GetStatisticsJson()
+{
+	std::ostringstream out;
+	out << "[";
+	bool first = true;
+	for (auto& statistics : GetStatistics())
+	{
+		out << (first ? "\n" : ",\n") << "  {\"name\": ";
+		first = false;
+		WriteJsonString(out, statistics.name);
+		out << ", \"loaded\": " << statistics.loaded
+			<< ", \"referenced\": " << statistics.referenced
+			<< ", \"unreferenced\": " << statistics.unreferenced
+			<< ", \"memoryUsage\": " << statistics.memoryUsage
+			<< ", \"loads\": " << statistics.loads
+			<< ", \"reloads\": " << statistics.reloads
+			<< ", \"skippedReloads\": " << statistics.skippedReloads
+			<< ", \"inPlaceReloads\": " << statistics.inPlaceReloads
+			<< ", \"failedReloads\": " << statistics.failedReloads
+			<< ", \"sharedHits\": " << statistics.sharedHits
+			<< ", \"hits\": " << statistics.hits
+			<< ", \"misses\": " << statistics.misses
+			<< ", \"hitRatio\": " << statistics.HitRatio()
+			<< ", \"factoryMicroseconds\": " << statistics.factoryMicroseconds
+			<< ", \"latencyHistogram\": [";
+		// trailing empty buckets are omitted
+		size_t used = ResourceTypeStatistics::LatencyBucketCount;
+		while (used > 0 && statistics.latencyHistogram[used - 1] == 0)
+		{
+			used--;
+		}
+		for (size_t i = 0; i < used; i++)
+		{
+			out << (i == 0 ? "" : ", ") << statistics.latencyHistogram[i];
+		}
+		out << "]}";
+	}
+	out << "\n]\n";
+	return out.str();
+}
+
+ResourceManager::ResourceManager() : looseFiles(std::make_shared<DirectoryMount>())
+{
+	fileSystem.Mount(looseFiles, LooseFilePriority);
+}
+
 ResourceManager::~ResourceManager()
 {
+	StopReloadThread();
+	{
+		std::lock_guard<std::mutex> guard(containerMutex);
+		stopAsyncThread = true;
+	}
+	containerChanged.notify_all();
+	for (auto& thread : asyncThreads)
+	{
+		thread.join();
+	}
+	for (auto& i : resourceSets)
+	{
+		JoinSetBuilder(*i.second);
+		DiscardStaged(i.second->staged);
+	}
+
+	// resources deleted below must not build stale ones again
+	for (auto& i : staleHolders)
+	{
+		i.first->stale_manager = nullptr;
+	}
+	staleHolders.clear();
+
+	// delete all resources before any holder is destroyed,
+	// resources might hold ResourcePtrs to other resources which decrement the count of their holders
+	ReleaseRetiredResources();
+	for (auto& i : container)
+	{
+		for (auto& entry : i.second.loaded)
+		{
+			auto& holder = entry.value;
+			delete holder.basePtr;
+			holder.basePtr = nullptr;
+			holder.derivedPtr = nullptr;
+		}
+	}
 	for (auto i = 0u; i < owned_factories_.size(); i++)
 	{
 		delete owned_factories_[i];
 	}
+	for (auto& chunk : handleChunks)
+	{
+		delete[] chunk.load();
+	}
 }
 
 ResourcePath::ResourcePath()
 {
-	data = "./";
+	Assign("./", 2);
 }
 
 ResourcePath::ResourcePath(const std::string& path)
 {
-	data = path; 
-	Normalize();
+	Assign(path.data(), path.size());
+	NormalizeConstructed();
 }
 
 ResourcePath::ResourcePath(const char* path)
 {
-	data = path;
-	Normalize();
+	Assign(path, std::strlen(path));
+	NormalizeConstructed();
+}
+
+void ResourcePath::NormalizeConstructed()
+{
+	try
+	{
+		Normalize();
+	}
+	catch (...)
+	{
+		// the destructor doesn't run when a constructor throws
+		Free();
+		throw;
+	}
 }
 
 bool operator==(const ResourcePath& lhs, const ResourcePath& rhs)
 {
-	return lhs.data == rhs.data;
+	return lhs.length == rhs.length && std::memcmp(lhs.Chars(), rhs.Chars(), lhs.length) == 0;
 }
 
 bool operator!=(const ResourcePath& lhs, const ResourcePath& rhs)
@@ -173,7 +1926,10 @@ bool operator!=(const ResourcePath& lhs, const ResourcePath& rhs)
 
 bool operator<(const ResourcePath& lhs, const ResourcePath& rhs)
 {
-	return lhs.data < rhs.data;
+	// same order as comparing them as strings
+	size_t common = lhs.length < rhs.length ? lhs.length : rhs.length;
+	int result = std::memcmp(lhs.Chars(), rhs.Chars(), common);
+	return result < 0 || (result == 0 && lhs.length < rhs.length);
 }
 
 bool operator<=(const ResourcePath& lhs, const ResourcePath& rhs)
@@ -193,7 +1949,7 @@ bool operator>=(const ResourcePath& lhs, const ResourcePath& rhs)
 
 std::ostream& operator<<(std::ostream& os, const ResourcePath& obj)
 {
-	return os << (obj.IsFilePath()?"file: ":"directory: ") << obj.data;
+	return os << (obj.IsFilePath()?"file: ":"directory: ") << obj.Chars();
 }
 
 ResourcePath operator+(const ResourcePath& lhs, const ResourcePath& rhs)
@@ -207,9 +1963,24 @@ ResourcePath& operator+=(ResourcePath& lhs, const ResourcePath& rhs)
 {
 	if (!lhs.IsDirectoryPath())
 	{
-		throw ResourcePath::Exception("Left hand side of concatenation cannot be a file path, cannot append anything to \"" + lhs.data + "\"");
+		throw ResourcePath::Exception("Left hand side of concatenation cannot be a file path, cannot append anything to \"" + lhs.ToString() + "\"");
+	}
+	// the ./ of a relative path would be a . segment in the middle, leave it out so the parser is not needed
+	if (&lhs == &rhs)
+	{
+		// appending would move the characters it reads from
+		ResourcePath copy(rhs);
+		return lhs += copy;
+	}
+	const char* chars = rhs.Chars();
+	if (rhs.length >= 2 && chars[0] == '.' && chars[1] == '/')
+	{
+		lhs.Append(chars + 2, rhs.length - 2);
+	}
+	else
+	{
+		lhs.Append(chars, rhs.length);
 	}
-	lhs.data += rhs.data;
 	lhs.Normalize();
 	return lhs;
 }
@@ -4,9 +4,28 @@
  *	Generic resource manager
  */
 
+#include <cstdint>
 #include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <iosfwd>
+#include <memory>
 #include "ResourcePath.hpp"
+#include "ResourcePathMap.hpp"
+#include "ResourcePathTrie.hpp"
+#include "InternedResourcePath.hpp"
+#include "ResourcePathResolver.hpp"
 #include "ITimestampingService.hpp"
+#include "IContentHashingService.hpp"
+#include "VirtualFileSystem.hpp"
+#include "SharedResourceCache.hpp"
+#include "InlineResource.hpp"
 #include "Console.hpp"
 
 class ManagedResource;
@@ -20,9 +39,32 @@ class ResourceFactory
 public:
 	// build a new resource, resource manager is passed in case additional resources are required
 	virtual ManagedResource* operator()(const ResourcePath& resourcePath, ResourceManagerLocation& resourceManager) = 0;
+	// called on reload instead of building a new resource, return false to build a new one instead
+	// update the existing resource to reuse its memory, large buffers and tables don't need to be allocated again
+	// other threads may be reading it meanwhile, so prepare the new contents first and swap them in at the end
+	// if it throws, the existing resource must be left usable
+	virtual bool ReloadInPlace(const ResourcePath& /*resourcePath*/, ResourceManagerLocation& /*resourceManager*/, ManagedResource& /*existing*/) { return false; }
+	// how many calls of this factory may run in parallel, 0 means no limit
+	// the default is 1 because most factories are not written to be thread safe
+	virtual unsigned MaxConcurrency() { return 1; }
+	// approximate number of bytes used by a resource built by this factory, used for statistics
+	virtual size_t GetMemoryUsage(const ManagedResource& resource);
 	virtual ~ResourceFactory(){};
 };
 
+// a factory of resources which keep all their data in one flat block of bytes, without pointers in it
+// such resources can be shared between processes, see ResourceManager::UseSharedCache
+class FlatResourceFactory : public ResourceFactory
+{
+public:
+	// build the bytes of a resource
+	virtual std::string BuildFlat(const ResourcePath& resourcePath, ResourceManagerLocation& resourceManager) = 0;
+	// make a resource which reads the bytes in place, it keeps the data so the bytes stay valid while it lives
+	virtual ManagedResource* FromFlat(const ResourcePath& resourcePath, ResourceData data) = 0;
+	// without a shared cache the bytes are built for this process only
+	ManagedResource* operator()(const ResourcePath& resourcePath, ResourceManagerLocation& resourceManager) override;
+};
+
 struct ManagedResourceHolder
 {
 	ManagedResourceHolder();
@@ -39,19 +81,73 @@ struct ManagedResourceHolder
 
 	~ManagedResourceHolder();
 
-	int reference_count;
+	std::atomic<int> reference_count;
 	long long timestamp;
-	ManagedResource* basePtr;
-	void *derivedPtr;
+	// hash of the file contents the resource was built from, 0 if unknown
+	unsigned long long content_hash;
+	std::atomic<ManagedResource*> basePtr;
+	std::atomic<void*> derivedPtr;
+
+	// true while the factory is building the resource, other threads wait for it
+	bool is_loading;
+	std::thread::id loading_thread;
+
+	// incremented every time a new version of the resource is published, 0 until the first version is published
+	std::atomic<unsigned> generation;
+
+	// quality of a complete resource, partial versions have lower quality
+	static const int CompleteQuality = 0x7fffffff;
+
+	// true while the published version is a partial one, published by the factory before it's done
+	std::atomic<bool> is_partial;
+	std::atomic<int> quality;
+
+	// unique for each holder of a manager, reset to 0 when the holder is destroyed
+	// the memory of the holder stays valid while the manager lives, so weak pointers can compare it
+	std::atomic<unsigned long long> id;
+
+	// the profile recording which last recorded this holder, guarded by the manager's containerMutex
+	unsigned profile_session;
+
+	// slot of the manager's handle table which points to this holder, 0 if no handle was made yet
+	uint32_t handle_index;
+
+	// version of the shared cache entry the resource was made from, or which was outdated when this process built it
+	// a reload only uses the shared cache if it has a newer version
+	unsigned long long shared_version;
+
+	// the manager which marked the resource as changed with ReloadPolicy::Lazy, nullptr while it's up to date
+	std::atomic<ResourceManager*> stale_manager;
+
+	// build the resource again if it was marked as changed, called on every access so the check is a single load
+	void RefreshIfStale()
+	{
+		if (stale_manager.load(std::memory_order_relaxed) != nullptr)
+		{
+			RefreshStale();
+		}
+	}
+
+	void RefreshStale();
 };
 
 // a managed pointer to an item of type T
 template <typename T>
 class ResourcePtr
 {
+	template <typename U> friend class WeakResourcePtr;
+	friend class ResourceManager;
 private:
 	ManagedResourceHolder* holder;
 
+	struct AdoptReference { };
+
+	// take over a reference which was already counted
+	ResourcePtr(ManagedResourceHolder* holder, AdoptReference)
+		: holder(holder)
+	{
+	}
+
 public:
 	ResourcePtr() 
 		: holder(nullptr)
@@ -179,12 +275,46 @@ public:
 		return holder != nullptr;
 	}
 
+	// version of the resource, changes every time the resource is reloaded, 0 if null or not loaded yet
+	// cache it next to derived data and compare to detect a reload
+	unsigned Generation() const
+	{
+		return holder == nullptr ? 0 : holder->generation.load(std::memory_order_acquire);
+	}
+
+	// returns true if the factory is still working and the current version is a partial one
+	bool IsPartial() const
+	{
+		return holder != nullptr && holder->is_partial;
+	}
+
+	// quality level given by the factory for partial versions, or ManagedResourceHolder::CompleteQuality
+	int Quality() const
+	{
+		return holder == nullptr ? 0 : holder->quality.load();
+	}
+
 	// clear this pointer, same as setting it to nullptr
 	void Clear()
 	{
 		this->operator=(nullptr);
 	}
 
+	// returns true if the file changed and the resource is built again on the next access, see ReloadPolicy::Lazy
+	bool IsStale() const
+	{
+		return holder != nullptr && holder->stale_manager.load() != nullptr;
+	}
+
+	// build the resource now if it's stale, instead of on the next access
+	void Refresh()
+	{
+		if (holder != nullptr)
+		{
+			holder->RefreshIfStale();
+		}
+	}
+
 	// arrow operator to get the pointer to T
 	T* operator->() 
 	{
@@ -193,11 +323,21 @@ public:
 		{
 			return nullptr;
 		}
-		if (holder->derivedPtr == nullptr)
+		holder->RefreshIfStale();
+		void* derived = holder->derivedPtr;
+		if (derived == nullptr)
 		{
-			holder->derivedPtr = dynamic_cast<T*>(holder->basePtr);
+			auto base = holder->basePtr.load();
+			derived = dynamic_cast<T*>(base);
+			holder->derivedPtr = derived;
+			// a new version published meanwhile cleared the cache before the store above, clear it again
+			if (holder->basePtr.load() != base)
+			{
+				void* expected = derived;
+				holder->derivedPtr.compare_exchange_strong(expected, nullptr);
+			}
 		}
-		return reinterpret_cast<T*>(holder->derivedPtr);
+		return reinterpret_cast<T*>(derived);
 	};
 
 	// defererence the pointer to get the reference
@@ -206,6 +346,88 @@ public:
 	}
 };
 
+// observes a resource without keeping it loaded, it doesn't count as a reference
+// use Lock to get a ResourcePtr, which is null if the resource was unloaded since
+template <typename T>
+class WeakResourcePtr
+{
+private:
+	ManagedResourceHolder* holder;
+	unsigned long long id;
+
+public:
+	WeakResourcePtr()
+		: holder(nullptr), id(0)
+	{
+	}
+
+	WeakResourcePtr(const ResourcePtr<T>& pointer)
+		: holder(pointer.holder), id(pointer.holder == nullptr ? 0 : pointer.holder->id.load())
+	{
+	}
+
+	WeakResourcePtr& operator=(const ResourcePtr<T>& pointer)
+	{
+		holder = pointer.holder;
+		id = holder == nullptr ? 0 : holder->id.load();
+		return *this;
+	}
+
+	// get a counted pointer to the resource, or a null pointer if it was unloaded
+	ResourcePtr<T> Lock() const
+	{
+		if (holder == nullptr)
+		{
+			return ResourcePtr<T>();
+		}
+		// a negative count means the holder is being unloaded, never revive it
+		int count = holder->reference_count.load();
+		do
+		{
+			if (count < 0)
+			{
+				return ResourcePtr<T>();
+			}
+		} while (!holder->reference_count.compare_exchange_weak(count, count + 1));
+		// the holder memory might have been reused for another resource
+		if (holder->id != id)
+		{
+			holder->reference_count--;
+			return ResourcePtr<T>();
+		}
+		return ResourcePtr<T>(holder, typename ResourcePtr<T>::AdoptReference());
+	}
+
+	// returns true if the resource was unloaded or this never pointed to anything
+	bool IsExpired() const
+	{
+		return holder == nullptr || holder->id != id;
+	}
+
+	// stop observing
+	void Clear()
+	{
+		holder = nullptr;
+		id = 0;
+	}
+};
+
+// a compact reference to a resource, an index into the handle table of the manager and a generation
+// it's 8 bytes, trivially copyable and doesn't count as a reference, so it fits into large arrays of plain data
+// when the resource is unloaded its slot gets a new generation and old handles resolve to null
+template <typename T>
+struct ResourceHandle
+{
+	uint32_t index = 0;
+	uint32_t generation = 0;
+
+	bool IsNull() const { return generation == 0; }
+
+	bool operator==(const ResourceHandle& other) const { return index == other.index && generation == other.generation; }
+
+	bool operator!=(const ResourceHandle& other) const { return !(*this == other); }
+};
+
 template <typename T> bool operator == (nullptr_t, ResourcePtr<T> ptr) {
 	return ptr.operator==(nullptr);
 }
@@ -224,8 +446,21 @@ class ResourceManagerLocation
 private:
 	ResourceManager* resourceManager = nullptr;
 	const ResourcePath* resourcePath = nullptr;
+	// set only while the factory is building the resource
+	ManagedResourceHolder* holder = nullptr;
 public:
 	template <typename T> ResourcePtr<T> Require(const ResourcePath& newLocation);
+
+	// read the contents of the resource being built, from a mounted pack or from a loose file
+	// throws std::runtime_error if it's not found
+	ResourceData Read() const;
+
+	// read the contents of another resource, relative paths start from the location of this resource
+	ResourceData Read(const ResourcePath& newLocation) const;
+
+	// called by a factory to publish a lower detail version of the resource before the complete one is ready
+	// it replaces the previous version right away and is deleted when the next version is published
+	void PublishPartial(ManagedResource* resource, int quality = 0);
 };
 
 class ManagedResource
@@ -234,106 +469,521 @@ class ManagedResource
 public:
 	ResourceManagerLocation resourceManager;
 	ManagedResource() {};
+	// approximate number of bytes used by this resource, used for statistics
+	virtual size_t GetMemoryUsage() const { return 0; }
 	virtual ~ManagedResource() {};
 };
 
+// statistics for a resource type, see ResourceManager::GetStatistics
+struct ResourceTypeStatistics
+{
+	// latency histogram bucket i counts factory calls that took less than 2^i microseconds
+	static const size_t LatencyBucketCount = 32;
+
+	std::string name;
+	size_t loaded = 0;
+	size_t referenced = 0;
+	size_t unreferenced = 0;
+	size_t memoryUsage = 0;
+	unsigned long long loads = 0;
+	unsigned long long reloads = 0;
+	// change notifications which found the file contents unchanged and didn't call the factory
+	unsigned long long skippedReloads = 0;
+	// reloads which updated the existing resource with ResourceFactory::ReloadInPlace
+	unsigned long long inPlaceReloads = 0;
+	// reloads where the factory threw, the previous version was kept
+	unsigned long long failedReloads = 0;
+	// loads which used the bytes of another process from the shared cache instead of building them
+	unsigned long long sharedHits = 0;
+	unsigned long long hits = 0;
+	unsigned long long misses = 0;
+	unsigned long long factoryMicroseconds = 0;
+	unsigned long long latencyHistogram[LatencyBucketCount] = {};
+
+	// ratio of Require calls which found the resource already loaded
+	double HitRatio() const;
+};
+
+
+// order in which queued loads are picked up by the loader threads, lower value goes first
+enum class LoadPriority
+{
+	Interactive = 0, // the user is waiting for it
+	Normal = 1,
+	Background = 2, // prefetch and warm-up, only runs when nothing else is queued
+};
+
+// what NotifyResourceChange does with the resources loaded from the changed file
+enum class ReloadPolicy
+{
+	Eager, // build them again right away
+	// unload the unreferenced ones, the others are built again the next time a ResourcePtr is dereferenced
+	// if that build fails the dereference still succeeds with the previous version, the change is dropped,
+	// the failure is counted in ResourceTypeStatistics::failedReloads and written to the console
+	Lazy,
+};
+
+// when the versions of resources replaced by a reload are deleted, see ResourceManager::SetRetirePolicy
+enum class RetirePolicy
+{
+	// when the next change is notified or unreferenced resources are collected, a pointer got from a ResourcePtr
+	// before the reload stays valid until then
+	NextChange,
+	// only by ReleaseRetiredResources or ProcessScheduledReloads, for readers which keep such pointers longer
+	Manual,
+};
+
+// a list of resources identified by type and path, see ResourceManager::Preload
+class ResourceList
+{
+public:
+	struct Entry
+	{
+		std::string type;
+		ResourcePath path;
+	};
+
+	// add a resource of type T
+	template <typename T> ResourceList& Add(const ResourcePath& path)
+	{
+		return Add(typeid(T).name(), path);
+	}
+
+	ResourceList& Add(const std::string& type, const ResourcePath& path)
+	{
+		entries.push_back(Entry{ type, path });
+		return *this;
+	}
+
+	// one entry per line, type and path separated by a tab
+	// type names come from typeid, so a saved list is only valid for builds made with the same compiler
+	void Write(std::ostream& out) const;
+	void Read(std::istream& in);
+
+	// throws std::runtime_error if the file can't be written or read
+	void Save(const std::string& fileName) const;
+	void Load(const std::string& fileName);
+
+	std::vector<Entry> entries;
+};
 
 class ResourceManager
 {
+	friend class ResourceManagerLocation;
+	friend struct ManagedResourceHolder;
 private:
 
 	bool tryCatchFactory = false;
 	bool verboseLoading = false;
 	Console* consoleInstance = nullptr;
 	ITimestampingService* timestampingService = nullptr;
+	IContentHashingService* contentHashingService = nullptr;
+	std::shared_ptr<SharedResourceCache> sharedCache;
 
 	struct ManagedResourceType
 	{
 		std::string name;
 		ResourceFactory* factory;
-		std::unordered_map<ResourcePath, ManagedResourceHolder, ResourcePath::Hasher> loaded;
+		ResourcePathMap<ManagedResourceHolder> loaded;
+		unsigned activeFactoryCalls;
+		// counters, guarded by containerMutex, the rest is computed when queried
+		ResourceTypeStatistics statistics;
 
 		ManagedResourceType();
 
 		ManagedResourceType(const std::string& name, ResourceFactory& factory);
 	};
 
+	// incremented on every reload of any resource
+	std::atomic<unsigned long long> reloadEpoch{ 0 };
+
+	// last id given to a holder, guarded by containerMutex
+	unsigned long long lastHolderId = 0;
+
 	// this is where the factory is called and new resource is built
-	void CallFactory(ResourceManager::ManagedResourceType& type, const ResourcePath& resource_path, ManagedResource*& resource);
+	// when existing is given the factory may update it in place, then resource is set to existing
+	void CallFactory(ResourceManager::ManagedResourceType& type, const ResourcePath& resource_path, ManagedResourceHolder* holder, ManagedResource*& resource, ManagedResource* existing = nullptr);
+
+	// give up the concurrency slot of the factory running on this thread while it requires another resource
+	// otherwise two gated factories requiring each other's types could wait for each other's slot
+	// returns false if the call holds no slot of this manager
+	bool ReleaseFactorySlot();
+	// wait for the slot again before the factory continues
+	void AcquireFactorySlot();
+
+	// build a resource of a flat factory through the shared cache, shared is set if the bytes came from the cache
+	ManagedResource* BuildShared(ManagedResourceType& type, FlatResourceFactory& factory, const ResourcePath& resource_path,
+		ResourceManagerLocation& location, ManagedResourceHolder* holder, bool& shared);
+
+	// tables of inline resources by type name, guarded by containerMutex, a table is never removed
+	std::unordered_map<std::string, std::unique_ptr<InlineResourceTableBase>> inlineTables;
+
+	template <typename T> InlineResourceTable<T>& GetInlineTable()
+	{
+		std::lock_guard<std::mutex> guard(containerMutex);
+		auto found = inlineTables.find(typeid(T).name());
+		if (found == inlineTables.end())
+		{
+			throw std::runtime_error(std::string("No inline factory registered for ") + typeid(T).name());
+		}
+		return static_cast<InlineResourceTable<T>&>(*found->second);
+	}
+
+	// get the container for a type, containerMutex must be held
+	ManagedResourceType& GetType(const std::string& typeName);
+
+	// get an existing ManagedResourceHolder or load a new one, waits if another thread is loading the same resource
+	// a reference for the caller is counted while the container is locked, so it can't be unloaded before it's adopted
+	ManagedResourceHolder* RequireHolder(const std::string& typeName, const ResourcePath& key);
+
+	// same with the ResourcePathMap hash of the key already computed
+	ManagedResourceHolder* RequireHolder(const std::string& typeName, const ResourcePath& key, size_t hash);
+
+	// get an existing ManagedResourceHolder or queue a new one to be loaded by the loader threads
+	// a load which is still queued with lower priority is promoted, the caller's reference is counted like RequireHolder
+	ManagedResourceHolder* RequireHolderAsync(const std::string& typeName, const ResourcePath& key, LoadPriority priority);
+
+	// reserve a holder and queue it for the loader threads, containerMutex must be held
+	ResourcePathMap<ManagedResourceHolder>::Entry* QueueLoad(ManagedResourceType& type, const ResourcePath& key, size_t hash, LoadPriority priority);
+
+	// add a holder to type.loaded and its path to loadedPaths, second is false if it was already there
+	// containerMutex must be held
+	std::pair<ResourcePathMap<ManagedResourceHolder>::Entry*, bool> InsertHolder(ManagedResourceType& type, const ResourcePath& key, size_t hash);
+
+	// add the path of an inline resource to loadedPaths
+	void AddInlinePath(const ResourcePath& key);
+
+	// erase an unloaded holder and invalidate its handle, containerMutex must be held
+	void EraseHolder(ManagedResourceType& type, ResourcePathMap<ManagedResourceHolder>::Entry* entry);
+
+	// get the handle slot of a holder, assign one if it has none yet
+	uint32_t AcquireHandle(ManagedResourceHolder* holder, uint32_t& generation);
+
+	// holder of a handle, nullptr if the handle is out of range or its resource was unloaded
+	ManagedResourceHolder* ResolveHandle(uint32_t index, uint32_t generation) const
+	{
+		if (index == 0 || index >= handleCount.load(std::memory_order_acquire))
+		{
+			return nullptr;
+		}
+		auto& slot = handleChunks[index >> HandleChunkBits].load(std::memory_order_acquire)[index & (HandleChunkSize - 1)];
+		if (slot.generation.load(std::memory_order_acquire) != generation)
+		{
+			return nullptr;
+		}
+		return slot.holder.load(std::memory_order_acquire);
+	}
+
+	// add the resource to the recorded profile if it's the first time it's required, containerMutex must be held
+	void RecordRequire(ManagedResourceType& type, ResourcePathMap<ManagedResourceHolder>::Entry& entry);
+
+	// remove a holder from the load queues, returns false if it's not queued, containerMutex must be held
+	bool RemoveQueuedLoad(ResourcePathMap<ManagedResourceHolder>::Entry* entry);
+
+	// drop a queued load, containerMutex must be held
+	bool CancelQueuedLoad(const std::string& typeName, const ResourcePath& key);
+
+	// call the factory for a reserved holder and publish the result
+	// if referenced, the caller counted a reference which is dropped when the load fails
+	void LoadHolder(ManagedResourceType& type, ResourcePathMap<ManagedResourceHolder>::Entry& entry, bool referenced = false);
+
+	void AsyncLoadLoop();
+
+	// what is known about a changed file, it's queried once even if several types were loaded from it
+	struct ChangedFile
+	{
+		bool timestampQueried = false;
+		long long timestamp = 0;
+		bool contentHashQueried = false;
+		unsigned long long contentHash = 0;
+	};
+
+	// build a holder reserved by this thread again, skipped if the file is older or has the same contents
+	// content_hash is the one the published version was built from, the holder is released also if the factory throws
+	void ReloadHolder(ManagedResourceType& type, const ResourcePath& resource_path, ManagedResourceHolder& holder, unsigned long long content_hash, ChangedFile& file);
+
+	// give up a holder reserved by this thread without publishing anything
+	void ReleaseHolder(ManagedResourceHolder& holder);
+
+	// holders marked by a lazy reload, guarded by containerMutex
+	struct StaleHolder
+	{
+		ManagedResourceType* type;
+		ResourcePathMap<ManagedResourceHolder>::Entry* entry;
+	};
+	std::unordered_map<ManagedResourceHolder*, StaleHolder> staleHolders;
+	ReloadPolicy reloadPolicy = ReloadPolicy::Eager;
+	RetirePolicy retirePolicy = RetirePolicy::NextChange;
+
+	// holders which changed while they were being loaded, the load may have read the file before the change
+	// they are reloaded by the thread which finishes the load, guarded by containerMutex
+	std::unordered_map<ManagedResourceHolder*, StaleHolder> pendingReloads;
+
+	// called when a load of the holder is done, if it changed meanwhile the holder stays reserved for this thread
+	// returns false if it didn't change, containerMutex must be held
+	bool TakePendingReload(ManagedResourceHolder& holder, StaleHolder& pending);
+
+	// reload a holder taken by TakePendingReload, failures are written to the console
+	void RunPendingReload(const StaleHolder& pending);
+
+	// reload a stale holder, called from ManagedResourceHolder::RefreshStale, doesn't throw
+	void RefreshHolder(ManagedResourceHolder& holder);
+
+	// swap a new version of the resource into the holder and retire the previous one
+	void PublishResource(ManagedResourceHolder& holder, const ResourcePath& resource_path, ManagedResource* resource, bool partial = false, int quality = 0);
+
+	// versions replaced by a newer one, deleted by ReleaseRetiredResources, guarded by containerMutex
+	std::vector<ManagedResource*> retiredResources;
+
+	// delete the retired versions unless the policy is RetirePolicy::Manual
+	void ReleaseRetiredOnChange();
+
+	// reload the resources of a changed path, NotifyResourceChange without releasing retired versions
+	void ReloadChangedPath(const ResourcePath& path);
+
+	// print preload progress, if console is available
+	void ReportPreloadProgress(size_t completed, size_t total);
+
+	// reload scheduled changes which have been quiet long enough, or all of them
+	size_t ReloadScheduledChanges(bool all);
+
+	void ReloadThreadLoop();
 
 	std::unordered_map<std::string, ManagedResourceType> container;
+
+	// what is loaded from each path, so that a directory change finds the paths under it without
+	// looking at the others, guarded by containerMutex
+	struct LoadedPath
+	{
+		unsigned holders = 0;
+		bool inlined = false;
+	};
+	ResourcePathTrie<LoadedPath> loadedPaths;
+
+	// paths required from inside factories, resolved relative to the resource being built
+	ResourcePathResolver resolvedLocations;
+
+	// resources are read through this, loose files on disk are mounted below everything else unless overridden
+	VirtualFileSystem fileSystem;
+	std::shared_ptr<DirectoryMount> looseFiles;
+
+	// handle table, chunks are never moved so a handle resolves with two loads and no lock
+	// slot 0 is never used, so the zero initialized handle is null
+	struct HandleSlot
+	{
+		std::atomic<ManagedResourceHolder*> holder{ nullptr };
+		std::atomic<uint32_t> generation{ 1 };
+	};
+	static const uint32_t HandleChunkBits = 12;
+	static const uint32_t HandleChunkSize = 1u << HandleChunkBits;
+	static const uint32_t MaxHandleChunks = 4096;
+	std::atomic<HandleSlot*> handleChunks[MaxHandleChunks] = {};
+	std::atomic<uint32_t> handleCount{ 1 };
+	// guarded by containerMutex
+	std::vector<uint32_t> freeHandles;
+
+	// resources in the order they were first required, guarded by containerMutex
+	bool recordingProfile = false;
+	unsigned profileSession = 0;
+	ResourceList recordedProfile;
 	std::vector<ResourceFactory*> owned_factories_;
 
+	// guards container, the lock is never held while a factory runs
+	std::mutex containerMutex;
+	// signaled when a resource finished loading or a factory slot was released
+	std::condition_variable containerChanged;
+
+	// changes waiting for the quiet period to pass, value is the time of the last notification
+	ResourcePathMap<std::chrono::steady_clock::time_point> scheduledChanges;
+	std::chrono::milliseconds reloadQuietPeriod{ 100 };
+	std::mutex scheduleMutex;
+	std::condition_variable scheduleChanged;
+	std::thread reloadThread;
+	bool stopReloadThread = false;
+
+	// holders waiting for the loader threads, one queue per LoadPriority, guarded by containerMutex
+	// a queued holder is loading but has no loading_thread until a loader picks it up
+	static const size_t PriorityCount = 3;
+	struct AsyncLoad
+	{
+		ManagedResourceType* type;
+		ResourcePathMap<ManagedResourceHolder>::Entry* entry;
+	};
+	std::deque<AsyncLoad> asyncQueues[PriorityCount];
+	std::vector<std::thread> asyncThreads;
+	unsigned asyncThreadCount = 1;
+	bool stopAsyncThread = false;
+
+	// a named group of resources which is built in the background and published at once
+	struct ResourceSet
+	{
+		// built but not published yet, owned by the set until it's committed
+		struct Staged
+		{
+			ManagedResourceType* type;
+			ResourcePath path;
+			ManagedResource* resource;
+			long long timestamp;
+			unsigned long long content_hash;
+		};
+
+		struct Member
+		{
+			ManagedResourceType* type;
+			ResourcePathMap<ManagedResourceHolder>::Entry* entry;
+		};
+
+		// committed resources, the set holds a reference to each so they stay loaded
+		std::vector<Member> members;
+		std::vector<Staged> staged;
+		std::exception_ptr failure;
+		std::thread builder;
+		std::atomic<bool> ready{ true };
+	};
+	// guarded by containerMutex, the builder thread only touches its set when it's done
+	// sets are never erased, so a set can be used without holding the lock
+	std::unordered_map<std::string, std::unique_ptr<ResourceSet>> resourceSets;
+
+	// get a set by name, throws std::runtime_error if it was never loaded
+	ResourceSet& GetSet(const std::string& name);
+
+	// build the resources of a set, runs on the set's builder thread
+	void BuildSet(ResourceSet& set, ResourceList list);
+
+	// wait until the set's builder thread finished and stored what it built
+	void JoinSetBuilder(ResourceSet& set);
+
+	// delete resources which were built but not committed
+	static void DiscardStaged(std::vector<ResourceSet::Staged>& staged);
+
 public:
 
 	// get a resource by either loading or reusing already loaded resource
 	template <typename T> ResourcePtr<T> Require(const ResourcePath& key)
 	{
-		// get type container
-		std::string name = typeid(T).name();
-		if (container.find(name) == container.end()) {
-			throw std::runtime_error("No factory registered for "+ name);
-		}
-		ManagedResourceType& type = container[name];
+		// return the required resource, its reference was counted by RequireHolder
+		return ResourcePtr<T>(RequireHolder(typeid(T).name(), key), typename ResourcePtr<T>::AdoptReference());
+	}
 
-		// get exiting ManagedResourceHolder or create a new
-		ManagedResourceHolder* finalResult;
-		auto searchResult = type.loaded.find(key); // search in container by ResourcePath
-		if (searchResult == type.loaded.end())
-		{
-			// not found, need to load new
-			ManagedResource* resource_raw_ptr;
+	// same, the hash of an interned path is already known, so the lookup doesn't go over the string to hash it
+	// resources are still stored by ResourcePath, so this saves the hashing, not memory, and a hit compares the string
+	template <typename T> ResourcePtr<T> Require(const InternedResourcePath& key)
+	{
+		return ResourcePtr<T>(RequireHolder(typeid(T).name(), key.Path(), key.Hash()), typename ResourcePtr<T>::AdoptReference());
+	}
 
-			// build
-			CallFactory(type, key, resource_raw_ptr);
+	// get a resource if it's loaded, otherwise return right away and load it on a background thread
+	// the pointer is not loaded until the factory publishes the first version, check IsLoaded or IsPartial
+	// queued loads run in priority order, requiring a queued resource with higher priority promotes it
+	// and a synchronous Require of a queued resource loads it right away on the calling thread
+	template <typename T> ResourcePtr<T> RequireAsync(const ResourcePath& key, LoadPriority priority = LoadPriority::Normal)
+	{
+		return ResourcePtr<T>(RequireHolderAsync(typeid(T).name(), key, priority), typename ResourcePtr<T>::AdoptReference());
+	}
 
-			// create holder object
-			ManagedResourceHolder newHolder(resource_raw_ptr, nullptr);
-			auto status = type.loaded.insert_or_assign(key, std::move(newHolder)); //emplace
-			auto& iterator = status.first;
+	// get a handle to a resource, the handle doesn't keep it loaded
+	// at most MaxHandleChunks * HandleChunkSize (16M) resources can have handles at the same time
+	template <typename T> ResourceHandle<T> GetHandle(const ResourcePtr<T>& pointer)
+	{
+		ResourceHandle<T> handle;
+		if (pointer.holder != nullptr)
+		{
+			handle.index = AcquireHandle(pointer.holder, handle.generation);
+		}
+		return handle;
+	}
 
-			// inject helper variables
-			if (resource_raw_ptr != nullptr)
-			{
-				resource_raw_ptr->resourceManager.resourceManager = this;
-				resource_raw_ptr->resourceManager.resourcePath = &(iterator->first);
-			}
+	// require a resource and get a handle to it, the resource stays loaded until CollectUnreferenced
+	template <typename T> ResourceHandle<T> RequireHandle(const ResourcePath& key)
+	{
+		return GetHandle(Require<T>(key));
+	}
 
-			// return fresly loaded 
-			finalResult = &(iterator->second);
-		} else
+	// get the resource of a handle, nullptr if it was unloaded or is not loaded yet
+	// the pointer is only valid until the resource is reloaded or unloaded, use Lock to keep it
+	template <typename T> T* Resolve(ResourceHandle<T> handle) const
+	{
+		auto holder = ResolveHandle(handle.index, handle.generation);
+		if (holder == nullptr)
 		{
-			// reuse existing
-			finalResult = &(searchResult->second);
+			return nullptr;
 		}
-		
-		// return the required resource
-		ResourcePtr<T> pointer(finalResult);
-		return pointer;
+		void* derived = holder->derivedPtr;
+		if (derived == nullptr)
+		{
+			return dynamic_cast<T*>(holder->basePtr.load());
+		}
+		return reinterpret_cast<T*>(derived);
 	}
 
-	// resolve new location from current location and require a resource
-	template <typename T> ResourcePtr<T> Require(const ResourcePath& currentLocation, const ResourcePath& newLocation)
+	// get a counted pointer to the resource of a handle, null if it was unloaded
+	template <typename T> ResourcePtr<T> Lock(ResourceHandle<T> handle)
 	{
-		ResourcePath location;
-		if (newLocation.IsRelativePath())
+		auto holder = ResolveHandle(handle.index, handle.generation);
+		if (holder == nullptr)
 		{
-			if (currentLocation.IsDirectoryPath())
-			{
-				location = currentLocation + newLocation;
-			}
-			else
+			return ResourcePtr<T>();
+		}
+		// same as WeakResourcePtr::Lock, a negative count means it's being unloaded
+		int count = holder->reference_count.load();
+		do
+		{
+			if (count < 0)
 			{
-				location = currentLocation.ToDirectory() + newLocation;
+				return ResourcePtr<T>();
 			}
-		}
-		else
+		} while (!holder->reference_count.compare_exchange_weak(count, count + 1));
+		if (ResolveHandle(handle.index, handle.generation) != holder)
 		{
-			location = newLocation;
+			holder->reference_count--;
+			return ResourcePtr<T>();
 		}
-		return this->Require<T>(location);
+		return ResourcePtr<T>(holder, typename ResourcePtr<T>::AdoptReference());
+	}
+
+	// remove a resource from the load queue if no loader picked it up yet, returns true if it was cancelled
+	// pointers to a cancelled resource stay not loaded until it's required again
+	template <typename T> bool CancelLoad(const ResourcePath& key)
+	{
+		return CancelQueuedLoad(typeid(T).name(), key);
 	}
 
+	// number of threads which load queued resources, default is 1, takes effect for threads started later
+	void SetAsyncThreadCount(unsigned count);
+
+	// resolve new location from current location and require a resource
+	// the resolved path is cached, so requiring the same relative path again doesn't build a new path
+	template <typename T> ResourcePtr<T> Require(const ResourcePath& currentLocation, const ResourcePath& newLocation)
+	{
+		auto resolved = resolvedLocations.Resolve(currentLocation, newLocation);
+		return ResourcePtr<T>(RequireHolder(typeid(T).name(), resolved.path, resolved.hash), typename ResourcePtr<T>::AdoptReference());
+	}
+
+	// relative paths are resolved from the directory of the current location, absolute paths are kept
+	static ResourcePath ResolveLocation(const ResourcePath& currentLocation, const ResourcePath& newLocation);
+
+	// mount a pack file, resources found in it are read from the mapped pack without copying
+	// packs mounted later take precedence, throws std::runtime_error if the pack can't be opened
+	void MountPack(const std::string& fileName);
+
+	void MountPack(std::shared_ptr<ResourcePack> pack);
+
+	// mount a directory, an in-memory overlay or any other source, see VirtualFileSystem::Mount
+	void Mount(std::shared_ptr<MountPoint> mount, int priority = 0);
+
+	bool Unmount(const std::shared_ptr<MountPoint>& mount);
+
+	// when enabled, loose files on disk are read before all mounts, so they can be edited during development
+	// otherwise loose files are only read when the resource is not found in any mount
+	void SetLooseFileOverride(bool enabled);
+
+	// read the contents of a resource through the mounts or from a loose file, throws std::runtime_error if not found
+	// where a path was found, or that it was not found, is cached until the path is notified as changed
+	ResourceData ReadResource(const ResourcePath& path);
+
+	// the mounts which ReadResource goes through
+	VirtualFileSystem& FileSystem() { return fileSystem; }
+
 	// register a factory instance that can build resources of type T
 	template <typename T> void RegisterFactory(ResourceFactory& instance) {
 		std::string name = typeid(T).name();
@@ -349,17 +999,152 @@ public:
 		RegisterFactory<T>(*factory);
 	}
 
+	// register a factory of small trivially copyable resources, they are stored by value in one table for type T
+	// registering again replaces the factory, values which are already loaded are kept
+	template <typename T> void RegisterInlineFactory(InlineResourceFactory<T>& factory)
+	{
+		std::lock_guard<std::mutex> guard(containerMutex);
+		auto& table = inlineTables[typeid(T).name()];
+		if (table == nullptr)
+		{
+			table.reset(new InlineResourceTable<T>(factory));
+		}
+		else
+		{
+			static_cast<InlineResourceTable<T>&>(*table).SetFactory(factory);
+		}
+	}
+
+	// get an inline resource, it's built on first use and stays loaded until the manager is destroyed
+	// NotifyResourceChange with its path builds it again and pointers to it see the new value right away
+	// throws std::runtime_error if no inline factory is registered for T
+	template <typename T> InlineResourcePtr<T> RequireInline(const ResourcePath& key)
+	{
+		auto& table = GetInlineTable<T>();
+		auto found = table.Find(key);
+		if (!found.IsNull())
+		{
+			return found;
+		}
+		// built without any lock, so the factory can require other resources
+		ResourceManagerLocation location;
+		location.resourceManager = this;
+		location.resourcePath = &key;
+		auto inserted = table.Insert(key, table.Factory().Build(key, location));
+		AddInlinePath(key);
+		return inserted;
+	}
+
+	// load all resources from the list using a pool of worker threads, blocks until all of them are loaded
+	// factories are called in parallel up to their MaxConcurrency, a thread count of 0 uses all hardware threads
+	void Preload(const ResourceList& list, unsigned threadCount = 0);
+
+	// start recording the order in which resources are loaded, each resource is recorded once, when it's first required
+	void StartProfileRecording();
+
+	// stop recording and get the recorded profile, save it and pass it to PrefetchProfile on the next run
+	ResourceList StopProfileRecording();
+
+	// queue every resource of a recorded profile for the loader threads in the recorded order and return right away
+	// entries which are already loaded or have no registered factory are skipped, since the profile might be outdated
+	// requiring a resource which is still queued loads it right away, so the profile never delays the caller
+	size_t PrefetchProfile(const ResourceList& profile, LoadPriority priority = LoadPriority::Background);
+
+	// start building every resource of the list on a background thread, nothing is published until CommitSet
+	// loading a set again rebuilds it from the current files, a build of the same set which was not committed is discarded
+	// resources required by the factories meanwhile are loaded and published as usual, only the listed ones wait for the commit
+	void LoadSet(const std::string& name, const ResourceList& list);
+
+	// true if the background build of the set is done, so CommitSet won't block
+	bool IsSetReady(const std::string& name);
+
+	// wait for the background build and publish all resources of the set at once, under a single lock
+	// pointers to them switch to the new versions together, the set keeps them loaded until UnloadSet
+	// resources of an earlier commit which are not in the new list are released
+	// throws std::runtime_error if the set was never loaded, rethrows the first build failure, then nothing is published
+	void CommitSet(const std::string& name);
+
+	// release the resources of a set and unload the ones which are not referenced by anything else
+	// returns the number of unloaded resources, resources which they required can be unloaded by CollectUnreferenced
+	size_t UnloadSet(const std::string& name);
+
 	//notify the manager that a resource at a given path has changed, and need reloading
+	// a resource which is being loaded meanwhile is built again by the loading thread once that version is published
+	// versions replaced by the previous change are deleted first, see RetirePolicy
 	void NotifyResourceChange(const ResourcePath& path);
 
+	// notify the manager that a directory was renamed, removed or replaced, everything loaded from under it
+	// is handled like NotifyResourceChange with its path, the work is proportional to what's under the directory
+	// all paths are processed even if reloading some of them fails, then the first failure is rethrown
+	void NotifyDirectoryChange(const ResourcePath& directory);
+
+	// choose between reloading changed resources right away or when they are used next, Eager by default
+	// with Lazy a change costs nothing for resources which are not used anymore, holders marked before
+	// switching back to Eager are still built again on their next access
+	void SetReloadPolicy(ReloadPolicy policy);
+
+	// choose when the versions replaced by a reload are deleted, NextChange by default
+	void SetRetirePolicy(RetirePolicy policy);
+
+	// like NotifyResourceChange, but the reload is delayed until the path has not been notified for the quiet period
+	// repeated notifications of the same path are merged into a single reload
+	void ScheduleResourceChange(const ResourcePath& path);
+
+	// how long a scheduled path must stay quiet before it's reloaded
+	void SetReloadQuietPeriod(long long milliseconds);
+
+	// reload scheduled changes which have been quiet long enough, call regularly from the main loop
+	// retired versions are released first, see ReleaseRetiredResources
+	// returns the number of reloaded paths, if some of them fail the others are still reloaded,
+	// then the first failure is rethrown, failed paths are not scheduled again
+	size_t ProcessScheduledReloads();
+
+	// reload all scheduled changes now, without waiting for the quiet period, failures as above
+	size_t FlushScheduledReloads();
+
+	// process scheduled reloads on a background thread instead of ProcessScheduledReloads
+	void StartReloadThread();
+
+	void StopReloadThread();
+
+	// delete the versions of resources which were replaced by a reload, returns the number of deleted versions
+	// they are kept because other threads might still use a pointer they got from ResourcePtr before the new version
+	// was published, call it where no thread keeps such a pointer, like between frames, see RetirePolicy
+	size_t ReleaseRetiredResources();
+
+	// unload all resources which are not referenced by any ResourcePtr, returns the number of unloaded resources
+	// resources released by unloaded resources are unloaded too, WeakResourcePtrs to them expire
+	size_t CollectUnreferenced();
+
+	// incremented every time any resource is reloaded, poll it to detect that something changed since last check
+	unsigned long long GetReloadEpoch() const;
+
 	void UseTimestampingService(ITimestampingService* service);
 
+	// with a hashing service a change notification only reloads if the file contents really changed
+	// the hash is taken right before the factory is called, so changes made while loading are not missed
+	void UseContentHashingService(IContentHashingService* service);
+
+	// resources of FlatResourceFactory types are taken from the shared cache if another process already built them
+	// a writable cache gets every flat resource which this process builds, a read only one is only read,
+	// so on a change notification a reader uses the new version once the writing process stored it,
+	// until then it builds the resource itself, readers should be notified after the writer to share the new version
+	void UseSharedCache(std::shared_ptr<SharedResourceCache> cache);
+
 	void UseConsole(Console* console);
 
 	void UseTryCatchFactory(bool tryCatch);
 
 	void SetVerboseLoading(bool verbose);
 
+	// get a snapshot of statistics for each registered resource type
+	std::vector<ResourceTypeStatistics> GetStatistics();
+
+	// get statistics for each registered resource type formatted as a JSON array
+	std::string GetStatisticsJson();
+
+	ResourceManager();
+
 	~ResourceManager();
 private:
 	
@@ -368,7 +1153,25 @@ private:
 template<typename T>
 inline ResourcePtr<T> ResourceManagerLocation::Require(const ResourcePath& newLocation)
 {
-	return resourceManager->Require<T>(*resourcePath, newLocation);
+	// the factory doesn't keep its concurrency slot while the required resource is loaded
+	bool released = resourceManager->ReleaseFactorySlot();
+	try
+	{
+		auto resource = resourceManager->Require<T>(*resourcePath, newLocation);
+		if (released)
+		{
+			resourceManager->AcquireFactorySlot();
+		}
+		return resource;
+	}
+	catch (...)
+	{
+		if (released)
+		{
+			resourceManager->AcquireFactorySlot();
+		}
+		throw;
+	}
 }
 
 
@@ -0,0 +1,230 @@
+#include "ResourcePack.hpp"
+#include "ContentHash.hpp"
+#include "FileMapping.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+static const char PackMagic[4] = { 'R', 'P', 'A', 'K' };
+
+uint64_t ResourcePack::HashPath(const ResourcePath& path)
+{
+	auto text = path.ToCharPtr();
+	return ContentHash(text, std::strlen(text));
+}
+
+ResourcePack::ResourcePack(const char* data, size_t size)
+	: data(data), size(size), header(nullptr), index(nullptr)
+{
+	Validate("memory");
+}
+
+ResourcePack::ResourcePack(const std::string& fileName)
+	: mapping(new FileMapping(fileName)), data(nullptr), size(0), header(nullptr), index(nullptr)
+{
+	if (!mapping->IsOpen())
+	{
+		throw std::runtime_error("Resource pack not found: " + fileName);
+	}
+	data = mapping->Data();
+	size = mapping->Size();
+	Validate(fileName);
+}
+
+// defined here where FileMapping is complete
+ResourcePack::~ResourcePack()
+{
+}
+
+void ResourcePack::Validate(const std::string& name)
+{
+	if (data == nullptr || size < sizeof(Header) || std::memcmp(data, PackMagic, sizeof(PackMagic)) != 0)
+	{
+		throw std::runtime_error("Not a resource pack: " + name);
+	}
+	if (reinterpret_cast<uintptr_t>(data) % alignof(IndexEntry) != 0)
+	{
+		throw std::runtime_error("Resource pack memory is not aligned: " + name);
+	}
+	header = reinterpret_cast<const Header*>(data);
+	if (header->version != Version)
+	{
+		throw std::runtime_error("Unsupported resource pack version: " + name);
+	}
+	if (header->entryCount > (size - sizeof(Header)) / sizeof(IndexEntry))
+	{
+		throw std::runtime_error("Resource pack index is truncated: " + name);
+	}
+	index = reinterpret_cast<const IndexEntry*>(data + sizeof(Header));
+	// check everything once here, so that lookups don't need to
+	for (size_t i = 0; i < header->entryCount; i++)
+	{
+		auto& entry = index[i];
+		if (entry.pathOffset > size || entry.pathLength >= size - entry.pathOffset || data[entry.pathOffset + entry.pathLength] != 0
+			|| entry.dataOffset > size || entry.dataSize > size - entry.dataOffset)
+		{
+			throw std::runtime_error("Resource pack entry is out of bounds: " + name);
+		}
+	}
+}
+
+bool ResourcePack::Find(const ResourcePath& path, const char*& resultData, size_t& resultSize) const
+{
+	auto text = path.ToCharPtr();
+	auto length = std::strlen(text);
+	auto hash = ContentHash(text, length);
+	auto end = index + header->entryCount;
+	auto entry = std::lower_bound(index, end, hash, [](const IndexEntry& entry, uint64_t hash) { return entry.pathHash < hash; });
+	for (; entry != end && entry->pathHash == hash; ++entry)
+	{
+		if (entry->pathLength == length && std::memcmp(data + entry->pathOffset, text, length) == 0)
+		{
+			resultData = data + entry->dataOffset;
+			resultSize = static_cast<size_t>(entry->dataSize);
+			return true;
+		}
+	}
+	return false;
+}
+
+ResourcePath ResourcePack::PathAt(size_t position) const
+{
+	if (position >= header->entryCount)
+	{
+		throw std::out_of_range("Resource pack index out of range");
+	}
+	return ResourcePath(data + index[position].pathOffset);
+}
+
+void ResourcePackWriter::Add(const ResourcePath& path, const std::string& contents)
+{
+	entries.push_back(Entry{ path, contents, std::string() });
+}
+
+void ResourcePackWriter::AddFile(const ResourcePath& path, const std::string& fileName)
+{
+	entries.push_back(Entry{ path, std::string(), fileName });
+}
+
+void ResourcePackWriter::Write(std::ostream& out, uint32_t alignment) const
+{
+	if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+	{
+		throw std::invalid_argument("Resource pack alignment must be a power of 2");
+	}
+	struct Placed
+	{
+		const Entry* entry;
+		uint64_t hash;
+		uint64_t size;
+	};
+	std::vector<Placed> placed;
+	placed.reserve(entries.size());
+	for (auto& entry : entries)
+	{
+		uint64_t entrySize = entry.contents.size();
+		if (entry.fileName.size() > 0)
+		{
+			std::ifstream file(entry.fileName, std::ios::binary | std::ios::ate);
+			if (!file)
+			{
+				throw std::runtime_error("Can't read file for resource pack: " + entry.fileName);
+			}
+			entrySize = static_cast<uint64_t>(file.tellg());
+		}
+		placed.push_back(Placed{ &entry, ResourcePack::HashPath(entry.path), entrySize });
+	}
+	std::sort(placed.begin(), placed.end(), [](const Placed& a, const Placed& b)
+	{
+		if (a.hash != b.hash) return a.hash < b.hash;
+		return std::strcmp(a.entry->path.ToCharPtr(), b.entry->path.ToCharPtr()) < 0;
+	});
+	for (size_t i = 1; i < placed.size(); i++)
+	{
+		if (placed[i - 1].hash == placed[i].hash && placed[i - 1].entry->path == placed[i].entry->path)
+		{
+			throw std::runtime_error("Resource added to pack twice: " + placed[i].entry->path.ToString());
+		}
+	}
+
+	// compute the offsets first, everything is written in one go after that
+	std::vector<ResourcePack::IndexEntry> index(placed.size());
+	uint64_t offset = sizeof(ResourcePack::Header) + sizeof(ResourcePack::IndexEntry) * placed.size();
+	for (size_t i = 0; i < placed.size(); i++)
+	{
+		auto length = std::strlen(placed[i].entry->path.ToCharPtr());
+		index[i].pathHash = placed[i].hash;
+		index[i].pathOffset = static_cast<uint32_t>(offset);
+		index[i].pathLength = static_cast<uint32_t>(length);
+		offset += length + 1;
+		if (offset > 0xffffffffull)
+		{
+			throw std::runtime_error("Resource pack paths are too long");
+		}
+	}
+	for (size_t i = 0; i < placed.size(); i++)
+	{
+		offset = (offset + alignment - 1) & ~static_cast<uint64_t>(alignment - 1);
+		index[i].dataOffset = offset;
+		index[i].dataSize = placed[i].size;
+		offset += placed[i].size;
+	}
+
+	ResourcePack::Header header;
+	std::memcpy(header.magic, PackMagic, sizeof(PackMagic));
+	header.version = ResourcePack::Version;
+	header.entryCount = static_cast<uint32_t>(placed.size());
+	header.alignment = alignment;
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	out.write(reinterpret_cast<const char*>(index.data()), sizeof(ResourcePack::IndexEntry) * index.size());
+	uint64_t written = sizeof(header) + sizeof(ResourcePack::IndexEntry) * index.size();
+	for (auto& item : placed)
+	{
+		auto text = item.entry->path.ToCharPtr();
+		auto length = std::strlen(text) + 1;
+		out.write(text, length);
+		written += length;
+	}
+	const char padding[256] = {};
+	std::vector<char> buffer;
+	for (size_t i = 0; i < placed.size(); i++)
+	{
+		while (written < index[i].dataOffset)
+		{
+			auto count = std::min<uint64_t>(index[i].dataOffset - written, sizeof(padding));
+			out.write(padding, static_cast<std::streamsize>(count));
+			written += count;
+		}
+		auto& entry = *placed[i].entry;
+		if (entry.fileName.size() > 0)
+		{
+			std::ifstream file(entry.fileName, std::ios::binary);
+			buffer.resize(static_cast<size_t>(placed[i].size));
+			if (!file.read(buffer.data(), buffer.size()))
+			{
+				throw std::runtime_error("Can't read file for resource pack: " + entry.fileName);
+			}
+			out.write(buffer.data(), buffer.size());
+		}
+		else
+		{
+			out.write(entry.contents.data(), entry.contents.size());
+		}
+		written += placed[i].size;
+	}
+	if (!out)
+	{
+		throw std::runtime_error("Failed to write resource pack");
+	}
+}
+
+void ResourcePackWriter::Write(const std::string& fileName, uint32_t alignment) const
+{
+	std::ofstream out(fileName, std::ios::binary | std::ios::trunc);
+	if (!out)
+	{
+		throw std::runtime_error("Can't create resource pack: " + fileName);
+	}
+	Write(out, alignment);
+}
@@ -0,0 +1,129 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "ResourcePath.hpp"
+
+class FileMapping;
+
+// read only contents of a resource, valid while any copy of this object exists
+// the bytes might point directly into a mapped pack or file, so nothing is copied
+class ResourceData
+{
+public:
+	ResourceData() { }
+
+	ResourceData(const char* data, size_t size, std::shared_ptr<const void> owner)
+		: data(data), size(size), owner(std::move(owner))
+	{
+	}
+
+	const char* Data() const { return data; }
+
+	size_t Size() const { return size; }
+
+	// true if no resource was found
+	bool IsNull() const { return owner == nullptr; }
+
+	// copy of the contents, for text resources
+	std::string ToString() const { return std::string(data, size); }
+
+private:
+	const char* data = nullptr;
+	size_t size = 0;
+	std::shared_ptr<const void> owner;
+};
+
+// many small resources packed into a single file, to avoid opening each file separately
+//
+// layout, all numbers little endian:
+//   header:  char magic[4] "RPAK", uint32 version, uint32 entryCount, uint32 alignment
+//   index:   entryCount times { uint64 pathHash, uint64 dataOffset, uint64 dataSize, uint32 pathOffset, uint32 pathLength }
+//            sorted by pathHash, then by path
+//   paths:   normalized ResourcePaths, each followed by a 0
+//   data:    contents of each resource, starting at a multiple of alignment
+class ResourcePack
+{
+public:
+	struct Header
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t entryCount;
+		uint32_t alignment;
+	};
+
+	struct IndexEntry
+	{
+		uint64_t pathHash;
+		uint64_t dataOffset;
+		uint64_t dataSize;
+		uint32_t pathOffset;
+		uint32_t pathLength;
+	};
+
+	static const uint32_t Version = 1;
+
+	// stable hash of a normalized path, it's stored in the pack so it must not depend on the build
+	static uint64_t HashPath(const ResourcePath& path);
+
+	// use a pack which is already in memory, the memory must stay valid while the pack is used
+	// throws std::runtime_error if the data is not a valid pack
+	ResourcePack(const char* data, size_t size);
+
+	// map a pack file into memory, throws std::runtime_error if it's missing or not a valid pack
+	explicit ResourcePack(const std::string& fileName);
+
+	~ResourcePack();
+
+	ResourcePack(const ResourcePack& other) = delete;
+	ResourcePack& operator=(const ResourcePack& other) = delete;
+
+	// look up a resource, on success data points into the pack
+	bool Find(const ResourcePath& path, const char*& data, size_t& size) const;
+
+	// number of resources in the pack
+	size_t Size() const { return header->entryCount; }
+
+	// path of the resource at an index position, for listing the contents
+	ResourcePath PathAt(size_t index) const;
+
+private:
+	std::unique_ptr<FileMapping> mapping;
+	const char* data;
+	size_t size;
+	const Header* header;
+	const IndexEntry* index;
+
+	void Validate(const std::string& name);
+};
+
+// collects resources and writes them as a ResourcePack
+class ResourcePackWriter
+{
+public:
+	// add a resource with the given contents
+	void Add(const ResourcePath& path, const std::string& contents);
+
+	// add a resource which is read from a file when the pack is written
+	void AddFile(const ResourcePath& path, const std::string& fileName);
+
+	size_t Size() const { return entries.size(); }
+
+	// write the pack, throws std::runtime_error if a file can't be read or the same path was added twice
+	void Write(std::ostream& out, uint32_t alignment = 16) const;
+
+	// write the pack to a file
+	void Write(const std::string& fileName, uint32_t alignment = 16) const;
+
+private:
+	struct Entry
+	{
+		ResourcePath path;
+		std::string contents;
+		std::string fileName; // empty if contents are given
+	};
+	std::vector<Entry> entries;
+};
@@ -4,20 +4,52 @@
 //#define RESOURCE_PATH_NO_DRIVE_LETTER_SUPPORT
 
 #include "ResourcePath.hpp"
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include "ContentHash.hpp"
 
-ResourcePath::ResourcePath(const ResourcePath& other) : data(other.data)
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define RESOURCE_PATH_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+// msvc compiles avx2 intrinsics without a target option
+#define RESOURCE_PATH_TARGET_AVX2
+#else
+#define RESOURCE_PATH_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+ResourcePath::ResourcePath(const ResourcePath& other)
 {
+	Assign(other.Chars(), other.length);
 }
 
-ResourcePath::ResourcePath(ResourcePath&& other) : data(std::move(other.data))
+ResourcePath::ResourcePath(ResourcePath&& other)
 {
+	if (other.heapCapacity != 0)
+	{
+		// steal the allocation, other is left as an empty inline path
+		heap = other.heap;
+		heapCapacity = other.heapCapacity;
+		length = other.length;
+		other.heapCapacity = 0;
+		other.length = 0;
+		other.buffer[0] = 0;
+	}
+	else
+	{
+		Assign(other.buffer, other.length);
+	}
 }
 
 ResourcePath& ResourcePath::operator=(const ResourcePath& other)
 {
 	if (this == &other)
 		return *this;
-	data = other.data;
+	Assign(other.Chars(), other.length);
 	return *this;
 }
 
@@ -25,10 +57,88 @@ ResourcePath& ResourcePath::operator=(ResourcePath&& other)
 {
 	if (this == &other)
 		return *this;
-	data = std::move(other.data);
+	if (other.heapCapacity != 0)
+	{
+		Free();
+		heap = other.heap;
+		heapCapacity = other.heapCapacity;
+		length = other.length;
+		other.heapCapacity = 0;
+		other.length = 0;
+		other.buffer[0] = 0;
+	}
+	else
+	{
+		Assign(other.buffer, other.length);
+	}
 	return *this;
 }
 
+ResourcePath::~ResourcePath()
+{
+	Free();
+}
+
+void ResourcePath::Free()
+{
+	if (heapCapacity != 0)
+	{
+		delete[] heap;
+		heapCapacity = 0;
+		length = 0;
+		buffer[0] = 0;
+	}
+}
+
+void ResourcePath::Reserve(size_t capacity)
+{
+	size_t current = heapCapacity != 0 ? heapCapacity : RESOURCE_PATH_INLINE_CAPACITY;
+	if (capacity <= current)
+	{
+		return;
+	}
+	if (capacity > UINT32_MAX)
+	{
+		throw ResourcePath::Exception("Path is too long");
+	}
+	size_t grown = current * 2 > capacity && current * 2 <= UINT32_MAX ? current * 2 : capacity;
+	char* allocated = new char[grown];
+	std::memcpy(allocated, Chars(), length + 1);
+	if (heapCapacity != 0)
+	{
+		delete[] heap;
+	}
+	heap = allocated;
+	heapCapacity = static_cast<uint32_t>(grown);
+}
+
+void ResourcePath::Assign(const char* chars, size_t count)
+{
+	Reserve(count + 1);
+	// chars may point into this path
+	std::memmove(Chars(), chars, count);
+	length = static_cast<uint32_t>(count);
+	Chars()[length] = 0;
+}
+
+void ResourcePath::Append(const char* chars, size_t count)
+{
+	Reserve(length + count + 1);
+	std::memcpy(Chars() + length, chars, count);
+	length += static_cast<uint32_t>(count);
+	Chars()[length] = 0;
+}
+
+void ResourcePath::ReplaceFront(size_t count, const char* replacement, size_t replacementLength)
+{
+	size_t rest = length - count;
+	Reserve(replacementLength + rest + 1);
+	char* chars = Chars();
+	std::memmove(chars + replacementLength, chars + count, rest + 1);
+	std::memcpy(chars, replacement, replacementLength);
+	length = static_cast<uint32_t>(replacementLength + rest);
+}
+
 bool ResourcePath::IsFilePath() const
 {
 	return !IsDirectoryPath();
@@ -36,13 +146,14 @@ bool ResourcePath::IsFilePath() const
 
 bool ResourcePath::IsDirectoryPath() const
 {
-	return data[data.size() - 1] == '/';
+	return length > 0 && Chars()[length - 1] == '/';
 }
 
 bool ResourcePath::IsRelativePath() const
 {
 	bool absolutePath = false;
-	if (data.size()>0)
+	const char* data = Chars();
+	if (length>0)
 	{
 		if (data[0] == '/') {
 			absolutePath = true;
@@ -64,12 +175,17 @@ bool ResourcePath::IsAbsolutePath() const
 
 const char* ResourcePath::ToCharPtr() const
 {
-	return data.c_str();
+	return Chars();
+}
+
+size_t ResourcePath::Length() const
+{
+	return length;
 }
 
 std::string ResourcePath::ToString() const
 {
-	return data;
+	return std::string(Chars(), length);
 }
 
 ResourcePath ResourcePath::ToDirectory() const
@@ -78,12 +194,17 @@ ResourcePath ResourcePath::ToDirectory() const
 	{
 		return *this;
 	}
-	for (int i = data.size() - 1; i >= 0; i--)
+	const char* data = Chars();
+	for (int i = static_cast<int>(length) - 1; i >= 0; i--)
 	{
 		char c = data[i];
 		if (c == '/')
 		{
-			return ResourcePath(data.substr(0, i + 1));
+			// a prefix of a normal path which ends with a separator is normal too
+			ResourcePath directory(*this);
+			directory.length = static_cast<uint32_t>(i + 1);
+			directory.Chars()[i + 1] = 0;
+			return directory;
 		}
 	}
 	return ResourcePath(); // current dir
@@ -93,15 +214,240 @@ ResourcePath ResourcePath::ToDirectory() const
 
 size_t ResourcePath::Hasher::operator()(const ResourcePath& obj) const
 {
-	return std::hash<std::string>()(obj.data);
+	return static_cast<size_t>(ContentHash(obj.Chars(), obj.length));
+}
+
+// the fast path converts the path in place and gives up at the first separator after a dot or another separator
+// which finds . and .. segments and empty ones, but also names ending with a dot, the parser drops those dots
+// giving up half way is fine, the parser does the same conversions again
+typedef bool(*ScanFunction)(char* data, size_t length, size_t start);
+
+static inline char ConvertChar(char c)
+{
+	if (c == '\\')
+	{
+		return '/';
+	}
+#ifndef RESOURCE_PATH_IS_CASE_SENSITIVE
+	if (c >= 'A' && c <= 'Z')
+	{
+		return c + ('a' - 'A');
+	}
+#endif
+	return c;
+}
+
+// convert from start to the end, data[start - 1] is already converted
+static bool ScanScalar(char* data, size_t length, size_t start)
+{
+	for (size_t i = start; i < length; i++)
+	{
+		char c = ConvertChar(data[i]);
+		data[i] = c;
+		if (c == '/' && i > 0 && (data[i - 1] == '/' || data[i - 1] == '.'))
+		{
+			return false;
+		}
+	}
+	return data[length - 1] != '.';
+}
+
+#ifdef RESOURCE_PATH_X86
+
+// a bit for each byte, bit i is set if byte i - 1 of the chunk is a separator and byte i is a separator,
+// or byte i - 1 is a dot and byte i is a separator, carry holds the previous chunk's last byte
+static inline bool HasSeparatorAfterDotOrSeparator(uint32_t separators, uint32_t dots, uint32_t carrySeparator, uint32_t carryDot)
+{
+	return (separators & ((separators << 1) | carrySeparator | (dots << 1) | carryDot)) != 0;
+}
+
+static bool ScanSse2(char* data, size_t length, size_t start)
+{
+	const __m128i backslash = _mm_set1_epi8('\\');
+	const __m128i slash = _mm_set1_epi8('/');
+	const __m128i dot = _mm_set1_epi8('.');
+	const __m128i swapSeparator = _mm_set1_epi8('\\' ^ '/');
+	const __m128i beforeA = _mm_set1_epi8('A' - 1);
+	const __m128i afterZ = _mm_set1_epi8('Z' + 1);
+	const __m128i caseBit = _mm_set1_epi8('a' - 'A');
+	uint32_t carrySeparator = start > 0 && data[start - 1] == '/';
+	uint32_t carryDot = start > 0 && data[start - 1] == '.';
+	size_t i = start;
+	for (; i + 16 <= length; i += 16)
+	{
+		__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+		chunk = _mm_xor_si128(chunk, _mm_and_si128(_mm_cmpeq_epi8(chunk, backslash), swapSeparator));
+#ifndef RESOURCE_PATH_IS_CASE_SENSITIVE
+		// signed compare, bytes above 127 are negative so they are never upper case
+		__m128i upper = _mm_and_si128(_mm_cmpgt_epi8(chunk, beforeA), _mm_cmplt_epi8(chunk, afterZ));
+		chunk = _mm_add_epi8(chunk, _mm_and_si128(upper, caseBit));
+#endif
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), chunk);
+		uint32_t separators = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, slash)));
+		uint32_t dots = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, dot)));
+		if (HasSeparatorAfterDotOrSeparator(separators, dots, carrySeparator, carryDot))
+		{
+			return false;
+		}
+		carrySeparator = separators >> 15;
+		carryDot = dots >> 15;
+	}
+	return ScanScalar(data, length, i);
+}
+
+RESOURCE_PATH_TARGET_AVX2 static bool ScanAvx2(char* data, size_t length, size_t start)
+{
+	const __m256i backslash = _mm256_set1_epi8('\\');
+	const __m256i slash = _mm256_set1_epi8('/');
+	const __m256i dot = _mm256_set1_epi8('.');
+	const __m256i swapSeparator = _mm256_set1_epi8('\\' ^ '/');
+	const __m256i beforeA = _mm256_set1_epi8('A' - 1);
+	const __m256i lastZ = _mm256_set1_epi8('Z');
+	const __m256i caseBit = _mm256_set1_epi8('a' - 'A');
+	uint32_t carrySeparator = start > 0 && data[start - 1] == '/';
+	uint32_t carryDot = start > 0 && data[start - 1] == '.';
+	size_t i = start;
+	for (; i + 32 <= length; i += 32)
+	{
+		__m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+		chunk = _mm256_xor_si256(chunk, _mm256_and_si256(_mm256_cmpeq_epi8(chunk, backslash), swapSeparator));
+#ifndef RESOURCE_PATH_IS_CASE_SENSITIVE
+		// avx2 has no signed less than, so upper case is above 'A' - 1 and not above 'Z'
+		__m256i upper = _mm256_andnot_si256(_mm256_cmpgt_epi8(chunk, lastZ), _mm256_cmpgt_epi8(chunk, beforeA));
+		chunk = _mm256_add_epi8(chunk, _mm256_and_si256(upper, caseBit));
+#endif
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(data + i), chunk);
+		uint32_t separators = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, slash)));
+		uint32_t dots = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, dot)));
+		if (HasSeparatorAfterDotOrSeparator(separators, dots, carrySeparator, carryDot))
+		{
+			return false;
+		}
+		carrySeparator = separators >> 31;
+		carryDot = dots >> 31;
+	}
+	// the upper halves must be cleared before sse code runs, otherwise every sse instruction after this is slow
+	// compilers do it on return but not always before a tail call
+	_mm256_zeroupper();
+	// the rest of the path is shorter than a chunk, sse2 takes 16 bytes of it
+	return ScanSse2(data, length, i);
+}
+
+static bool SupportsAvx2()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+	{
+		return false;
+	}
+	// the os must save the avx registers on context switches
+	__cpuid(info, 1);
+	const int osxsave = 1 << 27, avx = 1 << 28;
+	if ((info[2] & osxsave) == 0 || (info[2] & avx) == 0 || (_xgetbv(0) & 6) != 6)
+	{
+		return false;
+	}
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+#endif
+
+ResourcePath::NormalizeLevel ResourcePath::GetSupportedNormalizeLevel()
+{
+#ifdef RESOURCE_PATH_X86
+	static const NormalizeLevel supported = SupportsAvx2() ? NormalizeLevel::Avx2 : NormalizeLevel::Sse2;
+	return supported;
+#else
+	return NormalizeLevel::Scalar;
+#endif
+}
+
+static std::atomic<int> normalizeLevel{ static_cast<int>(ResourcePath::GetSupportedNormalizeLevel()) };
+
+ResourcePath::NormalizeLevel ResourcePath::SetNormalizeLevel(NormalizeLevel level)
+{
+	if (level > GetSupportedNormalizeLevel())
+	{
+		level = GetSupportedNormalizeLevel();
+	}
+	normalizeLevel = static_cast<int>(level);
+	return level;
+}
+
+ResourcePath::NormalizeLevel ResourcePath::GetNormalizeLevel()
+{
+	return static_cast<NormalizeLevel>(normalizeLevel.load());
 }
 
-// implemented as a simple state machine parser, since called regularly, optimised
 void ResourcePath::Normalize()
+{
+	if (!NormalizeSimple())
+	{
+		ParseNormalize();
+	}
+}
+
+bool ResourcePath::NormalizeSimple()
+{
+	ScanFunction scan;
+	switch (static_cast<NormalizeLevel>(normalizeLevel.load(std::memory_order_relaxed)))
+	{
+	case NormalizeLevel::Scalar:
+		scan = ScanScalar;
+		break;
+#ifdef RESOURCE_PATH_X86
+	case NormalizeLevel::Sse2:
+		scan = ScanSse2;
+		break;
+	case NormalizeLevel::Avx2:
+		scan = ScanAvx2;
+		break;
+#endif
+	default:
+		return false;
+	}
+	if (length == 0)
+	{
+		return false;
+	}
+	char* chars = Chars();
+	// the ./ of a normalized relative path is the one dot segment which is kept as it is
+	size_t start = 0;
+	if (length >= 2 && chars[0] == '.' && (chars[1] == '/' || chars[1] == '\\'))
+	{
+		chars[1] = '/';
+		start = 2;
+	}
+	if (!scan(chars, length, start))
+	{
+		return false;
+	}
+	if (start == 0 && chars[0] != '/')
+	{
+#ifndef RESOURCE_PATH_NO_DRIVE_LETTER_SUPPORT
+		if (length >= 3 && isalpha(chars[0]) && chars[1] == ':' && chars[2] == '/')
+		{
+			return true;
+		}
+#endif
+		ReplaceFront(0, "./", 2);
+	}
+	return true;
+}
+
+// implemented as a simple state machine parser, since called regularly, optimised
+void ResourcePath::ParseNormalize()
 {
 	// state variables
+	char* data = Chars();
 	int src, dest;
-	src = dest = data.size() - 1;
+	src = dest = static_cast<int>(length) - 1;
 	bool pathSep = false;
 	bool needToCompletePath = true;
 	int dotCount = 0;
@@ -173,7 +519,7 @@ void ResourcePath::Normalize()
 #ifndef RESOURCE_PATH_NO_DRIVE_LETTER_SUPPORT
 	if (isalpha(c))
 	{
-		if (static_cast<unsigned>(dest + 3)<data.size() && data[dest + 2] == ':' && data[dest + 3] == '/')
+		if (static_cast<unsigned>(dest + 3)<length && data[dest + 2] == ':' && data[dest + 3] == '/')
 		{
 			// we have a drive letter path
 			if (upLevel>0)
@@ -204,7 +550,8 @@ void ResourcePath::Normalize()
 					if (dest < 2)
 					{
 						// need some allocation
-						data = "../" + data.substr(dest + 1);
+						ReplaceFront(dest + 1, "../", 3);
+						data = Chars();
 						dest = -1;
 					}
 					else
@@ -220,7 +567,8 @@ void ResourcePath::Normalize()
 				if (dest < 1)
 				{
 					// need some allocation
-					data = "./" + data.substr(dest + 1);
+					ReplaceFront(dest + 1, "./", 2);
+					data = Chars();
 					dest = -1;
 				}
 				else
@@ -235,6 +583,6 @@ void ResourcePath::Normalize()
 	if (dest != -1)
 	{
 		// need adjustment
-		data = data.substr(dest + 1);
+		ReplaceFront(dest + 1, "", 0);
 	}
 }
\ No newline at end of file
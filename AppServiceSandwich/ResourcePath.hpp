@@ -1,7 +1,16 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
 #include <stdexcept>
 #include <string>
 
+// paths up to this many characters, including the terminating zero, are stored inside the ResourcePath
+// longer ones are allocated, the pointer to the allocation shares the space of the inline buffer
+// every resource map entry keeps a copy, so the default makes a ResourcePath 64 bytes, a cache line on x64
+#ifndef RESOURCE_PATH_INLINE_CAPACITY
+#define RESOURCE_PATH_INLINE_CAPACITY 56
+#endif
+
 
 // a class for handling paths towards resources
 class ResourcePath
@@ -28,6 +37,7 @@ public:
 	ResourcePath(ResourcePath&& other); // move
 	ResourcePath& operator=(const ResourcePath& other); //copy op
 	ResourcePath& operator=(ResourcePath&& other); // move
+	~ResourcePath();
 
 												   // check if the path points to a file
 	bool IsFilePath() const;
@@ -39,6 +49,10 @@ public:
 	bool IsAbsolutePath() const;
 	// return const char*, which can be passed to other APIs
 	const char* ToCharPtr() const;
+	// number of characters, without the terminating zero
+	size_t Length() const;
+	// true while the characters fit into the inline buffer, so nothing was allocated for them
+	bool IsInline() const { return heapCapacity == 0; }
 	// return a copy in std::string which can be passed (preferably moved) to other APIs
 	std::string ToString() const;
 	// implicit conversion operator so that you can pass ResourcePaths directly to functions that accept const char*
@@ -59,6 +73,22 @@ public:
 		size_t operator()(const ResourcePath& obj) const;
 	};
 
+	// implementations of the fast path of normalization, paths without . or .. segments skip the parser
+	// the best one the processor supports is chosen at startup, the others are there to be compared
+	enum class NormalizeLevel
+	{
+		Parser, // always use the parser
+		Scalar,
+		Sse2,
+		Avx2,
+	};
+
+	// use the given level, or the best supported one below it, returns the level in use
+	static NormalizeLevel SetNormalizeLevel(NormalizeLevel level);
+	static NormalizeLevel GetNormalizeLevel();
+	// the best level the processor supports
+	static NormalizeLevel GetSupportedNormalizeLevel();
+
 	// an exception type for this class only
 	class Exception : public std::runtime_error
 	{
@@ -68,9 +98,40 @@ public:
 	};
 
 private:
-	std::string data;
+	static_assert(RESOURCE_PATH_INLINE_CAPACITY >= 4, "the inline buffer must fit at least \"./\" and more");
+
+	// the characters with a terminating zero, in the inline buffer while heapCapacity is 0, otherwise in heap
+	uint32_t length = 0;
+	uint32_t heapCapacity = 0;
+	union
+	{
+		char* heap;
+		char buffer[RESOURCE_PATH_INLINE_CAPACITY];
+	};
+
+	char* Chars() { return heapCapacity != 0 ? heap : buffer; }
+	const char* Chars() const { return heapCapacity != 0 ? heap : buffer; }
+
+	// free the allocation, if any, the path is left as an empty inline path
+	void Free();
+
+	// make room for capacity characters including the terminating zero, keeps the contents
+	void Reserve(size_t capacity);
+	void Assign(const char* chars, size_t count);
+	void Append(const char* chars, size_t count);
+	// replace the first count characters with the replacement
+	void ReplaceFront(size_t count, const char* replacement, size_t replacementLength);
 
 	// bring the path to a normal form, automatically called every time path changes
 	// optimized, calling on already normalized paths is super fast, as there is no need for reallocation or resizing
 	void Normalize();
+
+	// Normalize for constructors, frees the allocation if it throws
+	void NormalizeConstructed();
+
+	// convert separators and case without the parser, false if the path needs the parser
+	bool NormalizeSimple();
+
+	// the full parser, resolves . and .. segments
+	void ParseNormalize();
 };
@@ -0,0 +1,286 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+#include <utility>
+#include "ResourcePath.hpp"
+
+// a hash map from ResourcePath to T, built for large numbers of entries
+// entries are stored in fixed size chunks, so the address of an entry never changes until it is erased
+// the index is a separate open addressing table with the precomputed hash next to the slot number,
+// so probing mostly touches the small index and only compares the key when the hash matches
+template <typename T> class ResourcePathMap
+{
+public:
+	struct Entry
+	{
+		const ResourcePath key;
+		const size_t hash;
+		T value;
+
+		Entry(const ResourcePath& key, size_t hash) : key(key), hash(hash), value() { }
+	};
+
+	class Iterator
+	{
+		friend class ResourcePathMap;
+		ResourcePathMap* map;
+		size_t slot;
+
+		Iterator(ResourcePathMap* map, size_t slot) : map(map), slot(slot) { SkipUnused(); }
+
+		void SkipUnused()
+		{
+			while (slot < map->slotCount && !map->IsUsed(slot)) slot++;
+		}
+
+	public:
+		Entry& operator*() const { return *map->EntryAt(slot); }
+		Entry* operator->() const { return map->EntryAt(slot); }
+		Iterator& operator++() { slot++; SkipUnused(); return *this; }
+		bool operator==(const Iterator& other) const { return slot == other.slot; }
+		bool operator!=(const Iterator& other) const { return slot != other.slot; }
+	};
+
+	ResourcePathMap() { }
+
+	ResourcePathMap(const ResourcePathMap& other) = delete;
+
+	// moving keeps the entries at the same address since chunks are not reallocated
+	ResourcePathMap(ResourcePathMap&& other) noexcept
+		: chunks(std::move(other.chunks)), index(std::move(other.index)), freeSlots(std::move(other.freeSlots)),
+		slotCount(other.slotCount), count(other.count), tombstones(other.tombstones)
+	{
+		other.slotCount = other.count = other.tombstones = 0;
+	}
+
+	ResourcePathMap& operator=(const ResourcePathMap& other) = delete;
+
+	ResourcePathMap& operator=(ResourcePathMap&& other) noexcept
+	{
+		if (this == &other)
+			return *this;
+		Clear();
+		chunks = std::move(other.chunks);
+		index = std::move(other.index);
+		freeSlots = std::move(other.freeSlots);
+		slotCount = other.slotCount;
+		count = other.count;
+		tombstones = other.tombstones;
+		other.slotCount = other.count = other.tombstones = 0;
+		return *this;
+	}
+
+	~ResourcePathMap()
+	{
+		Clear();
+	}
+
+	// the hash used by the map, compute it once and pass it to Find and Insert when the same key is used repeatedly
+	static size_t Hash(const ResourcePath& key)
+	{
+		return ResourcePath::Hasher()(key);
+	}
+
+	// find an entry, returns nullptr if not found
+	Entry* Find(const ResourcePath& key) { return Find(key, Hash(key)); }
+
+	Entry* Find(const ResourcePath& key, size_t hash)
+	{
+		if (index.size() == 0)
+			return nullptr;
+		size_t mask = index.size() - 1;
+		uint32_t tag = Tag(hash);
+		for (size_t i = hash & mask; ; i = (i + 1) & mask)
+		{
+			auto& bucket = index[i];
+			if (bucket.slot == EmptyBucket)
+				return nullptr;
+			if (bucket.slot != ErasedBucket && bucket.tag == tag)
+			{
+				Entry* entry = EntryAt(bucket.slot - FirstSlot);
+				if (entry->hash == hash && entry->key == key)
+					return entry;
+			}
+		}
+	}
+
+	// find an entry or insert a new one with a default constructed value, second is true if inserted
+	std::pair<Entry*, bool> Insert(const ResourcePath& key) { return Insert(key, Hash(key)); }
+
+	std::pair<Entry*, bool> Insert(const ResourcePath& key, size_t hash)
+	{
+		Entry* existing = Find(key, hash);
+		if (existing != nullptr)
+			return std::make_pair(existing, false);
+
+		if ((count + tombstones + 1) * 4 > index.size() * 3)
+			Rehash(count + 1);
+
+		size_t slot = AllocateSlot();
+		Entry* entry;
+		try
+		{
+			entry = new (EntryAt(slot)) Entry(key, hash);
+		}
+		catch (...)
+		{
+			freeSlots.push_back(slot);
+			throw;
+		}
+		SetUsed(slot, true);
+		PlaceInIndex(hash, slot);
+		count++;
+		return std::make_pair(entry, true);
+	}
+
+	// erase an entry returned by Find or Insert, the entry is destroyed and its slot reused by later inserts
+	void Erase(Entry* entry)
+	{
+		if (index.size() == 0)
+			return;
+		size_t mask = index.size() - 1;
+		for (size_t i = entry->hash & mask; ; i = (i + 1) & mask)
+		{
+			auto& bucket = index[i];
+			if (bucket.slot == EmptyBucket)
+				return; // not in this map
+			if (bucket.slot != ErasedBucket && EntryAt(bucket.slot - FirstSlot) == entry)
+			{
+				size_t slot = bucket.slot - FirstSlot;
+				bucket.slot = ErasedBucket;
+				tombstones++;
+				entry->~Entry();
+				SetUsed(slot, false);
+				freeSlots.push_back(slot);
+				count--;
+				return;
+			}
+		}
+	}
+
+	bool Erase(const ResourcePath& key)
+	{
+		Entry* entry = Find(key);
+		if (entry == nullptr)
+			return false;
+		Erase(entry);
+		return true;
+	}
+
+	size_t Size() const { return count; }
+
+	Iterator begin() { return Iterator(this, 0); }
+
+	Iterator end() { return Iterator(this, slotCount); }
+
+	void Clear()
+	{
+		for (size_t slot = 0; slot < slotCount; slot++)
+		{
+			if (IsUsed(slot))
+			{
+				EntryAt(slot)->~Entry();
+			}
+		}
+		chunks.clear();
+		index.clear();
+		freeSlots.clear();
+		slotCount = count = tombstones = 0;
+	}
+
+private:
+	static const size_t ChunkSize = 256;
+	static const uint32_t EmptyBucket = 0;
+	static const uint32_t ErasedBucket = 1;
+	static const uint32_t FirstSlot = 2;
+
+	struct Bucket
+	{
+		uint32_t tag;
+		uint32_t slot; // EmptyBucket, ErasedBucket or slot number + FirstSlot
+	};
+
+	struct Chunk
+	{
+		typename std::aligned_storage<sizeof(Entry), alignof(Entry)>::type entries[ChunkSize];
+		bool used[ChunkSize];
+	};
+
+	std::vector<std::unique_ptr<Chunk>> chunks;
+	std::vector<Bucket> index;
+	std::vector<size_t> freeSlots;
+	size_t slotCount = 0;
+	size_t count = 0;
+	size_t tombstones = 0;
+
+	static uint32_t Tag(size_t hash)
+	{
+		uint64_t wide = static_cast<uint64_t>(hash);
+		return static_cast<uint32_t>(wide ^ (wide >> 32));
+	}
+
+	Entry* EntryAt(size_t slot) const
+	{
+		return reinterpret_cast<Entry*>(&chunks[slot / ChunkSize]->entries[slot % ChunkSize]);
+	}
+
+	bool IsUsed(size_t slot) const
+	{
+		return chunks[slot / ChunkSize]->used[slot % ChunkSize];
+	}
+
+	void SetUsed(size_t slot, bool used)
+	{
+		chunks[slot / ChunkSize]->used[slot % ChunkSize] = used;
+	}
+
+	size_t AllocateSlot()
+	{
+		if (freeSlots.size() > 0)
+		{
+			size_t slot = freeSlots.back();
+			freeSlots.pop_back();
+			return slot;
+		}
+		if (slotCount == chunks.size() * ChunkSize)
+		{
+			std::unique_ptr<Chunk> chunk(new Chunk);
+			for (auto& used : chunk->used) used = false;
+			chunks.push_back(std::move(chunk));
+		}
+		return slotCount++;
+	}
+
+	void PlaceInIndex(size_t hash, size_t slot)
+	{
+		size_t mask = index.size() - 1;
+		size_t i = hash & mask;
+		while (index[i].slot != EmptyBucket && index[i].slot != ErasedBucket)
+		{
+			i = (i + 1) & mask;
+		}
+		if (index[i].slot == ErasedBucket)
+			tombstones--;
+		index[i].tag = Tag(hash);
+		index[i].slot = static_cast<uint32_t>(slot + FirstSlot);
+	}
+
+	// rebuild the index from the stored hashes, keys are never hashed again
+	void Rehash(size_t minimumCount)
+	{
+		size_t capacity = 16;
+		while (capacity * 3 < minimumCount * 4 * 2)
+			capacity *= 2;
+		index.assign(capacity, Bucket{ 0, EmptyBucket });
+		tombstones = 0;
+		for (size_t slot = 0; slot < slotCount; slot++)
+		{
+			if (IsUsed(slot))
+			{
+				PlaceInIndex(EntryAt(slot)->hash, slot);
+			}
+		}
+	}
+};
@@ -0,0 +1,404 @@
+#include "ResourcePathPattern.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <mutex>
+
+namespace
+{
+	enum class NfaKind : uint8_t
+	{
+		// the character, then the next state
+		Literal,
+		// a character other than a separator, then the next state
+		Any,
+		// stays on characters other than a separator, or skips to the next state
+		Star,
+		// a whole "**/" segment, skips to the state after GlobSegment, a separator stays, other characters go to GlobSegment
+		GlobStar,
+		// inside a segment skipped by the GlobStar before it, a separator goes back to it
+		GlobSegment,
+		// a trailing "**", stays on any character and skips to the accept state
+		Tail,
+		Accept
+	};
+
+	struct NfaState
+	{
+		NfaKind kind;
+		char character;
+		bool exclude;
+	};
+
+	bool IsGlobStar(const std::string& pattern, size_t i)
+	{
+		return (i == 0 || pattern[i - 1] == '/') && pattern.compare(i, 2, "**") == 0 && (i + 2 == pattern.size() || pattern[i + 2] == '/');
+	}
+
+	// append the states of a normalized pattern, the last one is its accept state
+	void AddPattern(const std::string& pattern, bool exclude, std::vector<NfaState>& states)
+	{
+		size_t length = pattern.size();
+		for (size_t i = 0; i < length;)
+		{
+			if (IsGlobStar(pattern, i))
+			{
+				if (i + 2 == length)
+				{
+					states.push_back(NfaState{ NfaKind::Tail, 0, false });
+					i += 2;
+				}
+				else
+				{
+					states.push_back(NfaState{ NfaKind::GlobStar, 0, false });
+					states.push_back(NfaState{ NfaKind::GlobSegment, 0, false });
+					i += 3;
+				}
+			}
+			else if (pattern[i] == '*')
+			{
+				while (i < length && pattern[i] == '*')
+				{
+					i++;
+				}
+				states.push_back(NfaState{ NfaKind::Star, 0, false });
+			}
+			else
+			{
+				states.push_back(NfaState{ pattern[i] == '?' ? NfaKind::Any : NfaKind::Literal, pattern[i], false });
+				i++;
+			}
+		}
+		states.push_back(NfaState{ NfaKind::Accept, 0, exclude });
+	}
+
+	// the state reached from state on character, -1 if there is none
+	long long Step(const std::vector<NfaState>& states, uint32_t index, char character)
+	{
+		// signed, so that -1 stays -1 in the conditionals below
+		long long state = index;
+		bool separator = character == '/';
+		switch (states[index].kind)
+		{
+		case NfaKind::Literal:
+			return character == states[index].character ? state + 1 : -1;
+		case NfaKind::Any:
+			return separator ? -1 : state + 1;
+		case NfaKind::Star:
+			return separator ? -1 : state;
+		case NfaKind::GlobStar:
+			return separator ? state : state + 1;
+		case NfaKind::GlobSegment:
+			return separator ? state - 1 : state;
+		case NfaKind::Tail:
+			return state;
+		default:
+			return -1;
+		}
+	}
+
+	// collects a set of NFA states with everything reachable from them without a character
+	class StateSetBuilder
+	{
+	public:
+		std::vector<uint32_t> set;
+
+		explicit StateSetBuilder(const std::vector<NfaState>& states) : states(states), marks(states.size(), 0) { }
+
+		void Begin()
+		{
+			set.clear();
+			generation++;
+		}
+
+		void Add(uint32_t state)
+		{
+			while (marks[state] != generation)
+			{
+				marks[state] = generation;
+				set.push_back(state);
+				auto kind = states[state].kind;
+				if (kind == NfaKind::Star || kind == NfaKind::Tail)
+				{
+					state += 1;
+				}
+				else if (kind == NfaKind::GlobStar)
+				{
+					state += 2;
+				}
+				else
+				{
+					return;
+				}
+			}
+		}
+
+	private:
+		const std::vector<NfaState>& states;
+		std::vector<uint32_t> marks;
+		uint32_t generation = 0;
+	};
+
+	bool GlobMatches(const char* begin, const char* pattern, const char* path)
+	{
+		while (*pattern != 0)
+		{
+			if ((pattern == begin || pattern[-1] == '/') && pattern[0] == '*' && pattern[1] == '*' && (pattern[2] == 0 || pattern[2] == '/'))
+			{
+				if (pattern[2] == 0)
+				{
+					return true;
+				}
+				// try the rest of the pattern after every separator
+				for (;;)
+				{
+					if (GlobMatches(begin, pattern + 3, path))
+					{
+						return true;
+					}
+					path = std::strchr(path, '/');
+					if (path == nullptr)
+					{
+						return false;
+					}
+					path++;
+				}
+			}
+			if (*pattern == '*')
+			{
+				while (*pattern == '*')
+				{
+					pattern++;
+				}
+				for (;;)
+				{
+					if (GlobMatches(begin, pattern, path))
+					{
+						return true;
+					}
+					if (*path == 0 || *path == '/')
+					{
+						return false;
+					}
+					path++;
+				}
+			}
+			if (*path == 0 || (*pattern == '?' ? *path == '/' : *pattern != *path))
+			{
+				return false;
+			}
+			pattern++;
+			path++;
+		}
+		return *path == 0;
+	}
+}
+
+struct ResourcePathPattern::Automaton
+{
+	struct DfaState
+	{
+		// sorted NFA states which are alive, the key of the state in dfaStates
+		const std::vector<uint32_t>* set;
+		bool accepting;
+		// nullptr until a path goes there the first time, written under the mutex
+		std::unique_ptr<std::atomic<const DfaState*>[]> next;
+	};
+
+	std::vector<NfaState> nfa;
+	bool hasIncludes;
+	// characters which no pattern tells apart share a class, so each state has one transition per class
+	// class 0 is every character which no pattern mentions, the separator and each literal get their own class
+	uint8_t classes[256];
+	std::vector<char> representatives;
+	bool hasOtherCharacters;
+	const DfaState* start;
+	const DfaState* dead;
+	size_t maxStates;
+
+	std::mutex mutex;
+	// guarded by mutex, states are never removed so readers don't need it
+	std::map<std::vector<uint32_t>, std::unique_ptr<DfaState>> dfaStates;
+
+	bool IsAccepting(const std::vector<uint32_t>& set) const
+	{
+		bool included = !hasIncludes;
+		for (auto state : set)
+		{
+			if (nfa[state].kind == NfaKind::Accept && nfa[state].exclude)
+			{
+				return false;
+			}
+			if (nfa[state].kind == NfaKind::Accept)
+			{
+				included = true;
+			}
+		}
+		return included;
+	}
+
+	// the set reached from set on a character of the class, in builder.set
+	void StepSet(const std::vector<uint32_t>& set, size_t characterClass, StateSetBuilder& builder) const
+	{
+		builder.Begin();
+		// when every character is a literal of some pattern class 0 is empty, it stays dead
+		if (characterClass == 0 && !hasOtherCharacters)
+		{
+			return;
+		}
+		for (auto state : set)
+		{
+			auto next = Step(nfa, state, representatives[characterClass]);
+			if (next >= 0)
+			{
+				builder.Add(static_cast<uint32_t>(next));
+			}
+		}
+		std::sort(builder.set.begin(), builder.set.end());
+	}
+
+	// find or add the DFA state of a sorted set, nullptr if there are maxStates already, mutex must be held
+	const DfaState* Intern(const std::vector<uint32_t>& set)
+	{
+		auto found = dfaStates.find(set);
+		if (found != dfaStates.end())
+		{
+			return found->second.get();
+		}
+		if (dfaStates.size() >= maxStates)
+		{
+			return nullptr;
+		}
+		auto inserted = dfaStates.emplace(set, std::unique_ptr<DfaState>(new DfaState()));
+		auto& created = inserted.first->second;
+		created->set = &inserted.first->first;
+		created->accepting = IsAccepting(set);
+		created->next.reset(new std::atomic<const DfaState*>[representatives.size()]);
+		for (size_t i = 0; i < representatives.size(); i++)
+		{
+			created->next[i].store(nullptr, std::memory_order_relaxed);
+		}
+		return created.get();
+	}
+
+	// build the transition of a state the first time a path takes it, nullptr if the DFA is full
+	const DfaState* AddTransition(const DfaState& state, size_t characterClass)
+	{
+		StateSetBuilder builder(nfa);
+		StepSet(*state.set, characterClass, builder);
+		std::lock_guard<std::mutex> guard(mutex);
+		auto next = Intern(builder.set);
+		if (next != nullptr)
+		{
+			state.next[characterClass].store(next, std::memory_order_release);
+		}
+		return next;
+	}
+
+	// follow the NFA for the rest of the path, without adding DFA states
+	bool MatchNfa(const std::vector<uint32_t>& from, const char* rest) const
+	{
+		StateSetBuilder builder(nfa);
+		std::vector<uint32_t> set = from;
+		for (; *rest != 0 && !set.empty(); rest++)
+		{
+			StepSet(set, classes[static_cast<uint8_t>(*rest)], builder);
+			set.swap(builder.set);
+		}
+		return IsAccepting(set);
+	}
+};
+
+ResourcePathPattern::ResourcePathPattern(const std::vector<std::string>& include, const std::vector<std::string>& exclude, size_t maxStates) : automaton(new Automaton())
+{
+	// the dead and the start state are always there
+	automaton->maxStates = std::max(maxStates, size_t(2));
+	auto& nfa = automaton->nfa;
+	std::vector<uint32_t> starts;
+	for (size_t i = 0; i < include.size() + exclude.size(); i++)
+	{
+		bool isExclude = i >= include.size();
+		starts.push_back(static_cast<uint32_t>(nfa.size()));
+		AddPattern(ResourcePath(isExclude ? exclude[i - include.size()] : include[i]).ToString(), isExclude, nfa);
+	}
+	automaton->hasIncludes = !include.empty();
+
+	auto classes = automaton->classes;
+	auto& representatives = automaton->representatives;
+	std::fill(classes, classes + 256, uint8_t(0));
+	representatives.push_back(0);
+	classes[static_cast<uint8_t>('/')] = 1;
+	representatives.push_back('/');
+	for (auto& state : nfa)
+	{
+		auto character = static_cast<uint8_t>(state.character);
+		if (state.kind == NfaKind::Literal && classes[character] == 0)
+		{
+			classes[character] = static_cast<uint8_t>(representatives.size());
+			representatives.push_back(state.character);
+		}
+	}
+	automaton->hasOtherCharacters = false;
+	for (int character = 1; character < 256 && !automaton->hasOtherCharacters; character++)
+	{
+		if (classes[character] == 0)
+		{
+			representatives[0] = static_cast<char>(character);
+			automaton->hasOtherCharacters = true;
+		}
+	}
+
+	std::lock_guard<std::mutex> guard(automaton->mutex);
+	automaton->dead = automaton->Intern(std::vector<uint32_t>());
+	for (size_t i = 0; i < representatives.size(); i++)
+	{
+		automaton->dead->next[i].store(automaton->dead, std::memory_order_relaxed);
+	}
+	StateSetBuilder builder(nfa);
+	builder.Begin();
+	for (auto state : starts)
+	{
+		builder.Add(state);
+	}
+	std::sort(builder.set.begin(), builder.set.end());
+	automaton->start = automaton->Intern(builder.set);
+}
+
+// defined here where Automaton is complete
+ResourcePathPattern::~ResourcePathPattern()
+{
+}
+
+bool ResourcePathPattern::Matches(const ResourcePath& path) const
+{
+	auto& dfa = *automaton;
+	auto state = dfa.start;
+	for (auto character = path.ToCharPtr(); *character != 0 && state != dfa.dead; character++)
+	{
+		size_t characterClass = dfa.classes[static_cast<uint8_t>(*character)];
+		auto next = state->next[characterClass].load(std::memory_order_acquire);
+		if (next == nullptr)
+		{
+			next = dfa.AddTransition(*state, characterClass);
+			if (next == nullptr)
+			{
+				return dfa.MatchNfa(*state->set, character);
+			}
+		}
+		state = next;
+	}
+	return state->accepting;
+}
+
+bool ResourcePathPattern::MatchGlob(const ResourcePath& pattern, const ResourcePath& path)
+{
+	return GlobMatches(pattern.ToCharPtr(), pattern.ToCharPtr(), path.ToCharPtr());
+}
+
+size_t ResourcePathPattern::StateCount() const
+{
+	std::lock_guard<std::mutex> guard(automaton->mutex);
+	return automaton->dfaStates.size();
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "ResourcePath.hpp"
+
+// a set of include and exclude globs compiled into a single automaton, so a path is matched against all of them
+// in one pass over its characters, no matter how many patterns there are
+//
+// patterns are normalized like paths, so relative patterns match relative paths:
+//   *   any characters within a segment
+//   ?   one character within a segment
+//   **  as a whole segment, any number of segments, "a/**/b" matches "a/b" and "a/x/y/b",
+//       at the end "a/**" matches everything under "a/"
+// a path matches the set if an include pattern matches it and no exclude pattern does,
+// without include patterns every path which is not excluded matches
+//
+// the patterns are one NFA, DFA states are built from it when a path first reaches them and kept,
+// so later paths follow a single table entry per character, a full DFA of hundreds of patterns could be huge
+// after maxStates states the rest of a path follows the NFA, slower but still one pass
+//
+// the patterns don't change after construction, it can be used from many threads
+class ResourcePathPattern
+{
+public:
+	explicit ResourcePathPattern(const std::vector<std::string>& include, const std::vector<std::string>& exclude = std::vector<std::string>(), size_t maxStates = 16384);
+
+	~ResourcePathPattern();
+
+	ResourcePathPattern(const ResourcePathPattern& other) = delete;
+	ResourcePathPattern& operator=(const ResourcePathPattern& other) = delete;
+
+	bool Matches(const ResourcePath& path) const;
+
+	// match a single pattern by backtracking, the same rules without building anything
+	static bool MatchGlob(const ResourcePath& pattern, const ResourcePath& path);
+
+	// number of DFA states built so far, including the one for paths which can't match anything anymore
+	size_t StateCount() const;
+
+private:
+	struct Automaton;
+	std::unique_ptr<Automaton> automaton;
+};
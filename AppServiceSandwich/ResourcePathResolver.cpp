@@ -0,0 +1,195 @@
+#include "ResourcePathResolver.hpp"
+#include "ContentHash.hpp"
+#include "ResourcePathMap.hpp"
+#include <cstring>
+
+ResourcePathResolver::ResourcePathResolver(size_t capacity, size_t shardCount)
+{
+	size_t count = 1;
+	while (count < shardCount)
+	{
+		count *= 2;
+	}
+	shardCapacity = capacity > count ? (capacity + count - 1) / count : 1;
+	shardMask = count - 1;
+	for (size_t i = 0; i < count; i++)
+	{
+		shards.push_back(std::unique_ptr<Shard>(new Shard()));
+		shards.back()->index.assign(16, Slot{ 0, 0 });
+	}
+}
+
+ResourcePath ResourcePathResolver::ResolveLocation(const ResourcePath& currentLocation, const ResourcePath& newLocation)
+{
+	if (!newLocation.IsRelativePath())
+	{
+		return newLocation;
+	}
+	if (currentLocation.IsDirectoryPath())
+	{
+		return currentLocation + newLocation;
+	}
+	return currentLocation.ToDirectory() + newLocation;
+}
+
+// the part of the current location which the result depends on, up to and including its last separator
+static size_t DirectoryLength(const ResourcePath& currentLocation)
+{
+	const char* current = currentLocation.ToCharPtr();
+	for (size_t i = currentLocation.Length(); i > 0; i--)
+	{
+		if (current[i - 1] == '/')
+		{
+			return i;
+		}
+	}
+	return 0;
+}
+
+ResourcePathResolver::Slot& ResourcePathResolver::Probe(Shard& shard, uint64_t hash, const char* directory, size_t directoryLength, const ResourcePath& relative)
+{
+	size_t mask = shard.index.size() - 1;
+	for (size_t i = static_cast<size_t>(hash) & mask;; i = (i + 1) & mask)
+	{
+		auto& slot = shard.index[i];
+		if (slot.entry == 0)
+		{
+			return slot;
+		}
+		auto& entry = shard.entries[slot.entry - 1];
+		if (slot.hash == hash && entry.directory.size() == directoryLength
+			&& std::memcmp(entry.directory.data(), directory, directoryLength) == 0 && entry.relative == relative)
+		{
+			return slot;
+		}
+	}
+}
+
+void ResourcePathResolver::Grow(Shard& shard)
+{
+	std::vector<Slot> previous(shard.index.size() * 2, Slot{ 0, 0 });
+	previous.swap(shard.index);
+	size_t mask = shard.index.size() - 1;
+	for (auto& slot : previous)
+	{
+		if (slot.entry != 0)
+		{
+			size_t i = static_cast<size_t>(slot.hash) & mask;
+			while (shard.index[i].entry != 0)
+			{
+				i = (i + 1) & mask;
+			}
+			shard.index[i] = slot;
+		}
+	}
+}
+
+size_t ResourcePathResolver::Evict(Shard& shard)
+{
+	// skip the entries used since the hand passed them last time, they get one more round
+	while (shard.entries[shard.hand].referenced)
+	{
+		shard.entries[shard.hand].referenced = false;
+		shard.hand = (shard.hand + 1) % shard.entries.size();
+	}
+	size_t victim = shard.hand;
+	shard.hand = (shard.hand + 1) % shard.entries.size();
+
+	size_t mask = shard.index.size() - 1;
+	size_t i = static_cast<size_t>(shard.entries[victim].hash) & mask;
+	while (shard.index[i].entry != victim + 1)
+	{
+		i = (i + 1) & mask;
+	}
+	// shift the following slots back, so that no probe stops early at the hole
+	for (size_t j = (i + 1) & mask; shard.index[j].entry != 0; j = (j + 1) & mask)
+	{
+		size_t home = static_cast<size_t>(shard.index[j].hash) & mask;
+		if (((j - home) & mask) >= ((j - i) & mask))
+		{
+			shard.index[i] = shard.index[j];
+			i = j;
+		}
+	}
+	shard.index[i] = Slot{ 0, 0 };
+	shard.statistics.evictions++;
+	return victim;
+}
+
+ResourcePathResolver::Resolved ResourcePathResolver::Resolve(const ResourcePath& currentLocation, const ResourcePath& newLocation)
+{
+	// an absolute path doesn't depend on the current location at all
+	const char* directory = currentLocation.ToCharPtr();
+	size_t directoryLength = newLocation.IsRelativePath() ? DirectoryLength(currentLocation) : 0;
+	uint64_t hash = ContentHash(directory, directoryLength, ContentHash(newLocation.ToCharPtr(), newLocation.Length()));
+	auto& shard = ShardOf(hash);
+	{
+		std::lock_guard<std::mutex> guard(shard.mutex);
+		shard.statistics.lookups++;
+		auto& slot = Probe(shard, hash, directory, directoryLength, newLocation);
+		if (slot.entry != 0)
+		{
+			shard.statistics.hits++;
+			auto& entry = shard.entries[slot.entry - 1];
+			entry.referenced = true;
+			return entry.resolved;
+		}
+	}
+
+	// build it outside the lock, if another thread added the same pair meanwhile that one is kept
+	Resolved resolved{ ResolveLocation(currentLocation, newLocation), 0 };
+	resolved.hash = ResourcePathMap<int>::Hash(resolved.path);
+	std::lock_guard<std::mutex> guard(shard.mutex);
+	if (Probe(shard, hash, directory, directoryLength, newLocation).entry != 0)
+	{
+		return resolved;
+	}
+	size_t position;
+	if (shard.entries.size() < shardCapacity)
+	{
+		position = shard.entries.size();
+		shard.entries.push_back(Entry{ hash, std::string(directory, directoryLength), newLocation, resolved, false });
+		// keep the index at most half full
+		if (shard.entries.size() * 2 > shard.index.size())
+		{
+			Grow(shard);
+		}
+	}
+	else
+	{
+		position = Evict(shard);
+		auto& entry = shard.entries[position];
+		entry.hash = hash;
+		entry.directory.assign(directory, directoryLength);
+		entry.relative = newLocation;
+		entry.resolved = resolved;
+		entry.referenced = false;
+	}
+	// probed again, the index may have changed since
+	Probe(shard, hash, directory, directoryLength, newLocation) = Slot{ hash, static_cast<uint32_t>(position + 1) };
+	return resolved;
+}
+
+size_t ResourcePathResolver::Size()
+{
+	size_t size = 0;
+	for (auto& shard : shards)
+	{
+		std::lock_guard<std::mutex> guard(shard->mutex);
+		size += shard->entries.size();
+	}
+	return size;
+}
+
+ResourcePathResolver::Statistics ResourcePathResolver::GetStatistics()
+{
+	Statistics total;
+	for (auto& shard : shards)
+	{
+		std::lock_guard<std::mutex> guard(shard->mutex);
+		total.lookups += shard->statistics.lookups;
+		total.hits += shard->statistics.hits;
+		total.evictions += shard->statistics.evictions;
+	}
+	return total;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "ResourcePath.hpp"
+
+// remembers where relative paths lead from a directory, so nested Require calls don't build and normalize
+// the same path again, a resource which requires many siblings resolves each of them once
+// results depend on nothing but the two paths, so they never need to be invalidated
+// the cache is split into shards with their own lock, so loader threads resolving paths rarely wait for each other,
+// a full shard evicts with the CLOCK policy, results used again since the hand last passed them are kept
+class ResourcePathResolver
+{
+public:
+	// a resolved path with its ResourcePathMap hash
+	struct Resolved
+	{
+		ResourcePath path;
+		size_t hash;
+	};
+
+	struct Statistics
+	{
+		unsigned long long lookups = 0;
+		unsigned long long hits = 0;
+		unsigned long long evictions = 0;
+	};
+
+	// about capacity results are remembered, split evenly between the shards, but at least one in each
+	// shardCount is rounded up to a power of 2
+	explicit ResourcePathResolver(size_t capacity = 65536, size_t shardCount = 16);
+
+	ResourcePathResolver(const ResourcePathResolver& other) = delete;
+	ResourcePathResolver& operator=(const ResourcePathResolver& other) = delete;
+
+	// relative paths are resolved from the directory of the current location, absolute paths are kept
+	static ResourcePath ResolveLocation(const ResourcePath& currentLocation, const ResourcePath& newLocation);
+
+	// same as ResolveLocation, from the cache if the pair was resolved before
+	// the result is a copy, since the cached one can be evicted by another thread
+	Resolved Resolve(const ResourcePath& currentLocation, const ResourcePath& newLocation);
+
+	size_t Size();
+
+	Statistics GetStatistics();
+
+private:
+	struct Entry
+	{
+		uint64_t hash;
+		std::string directory;
+		ResourcePath relative;
+		Resolved resolved;
+		// set when the entry is used, cleared when the clock hand passes it
+		bool referenced;
+	};
+
+	// open addressing index into entries, the key hash is kept next to the entry so most probes don't touch it
+	struct Slot
+	{
+		uint64_t hash;
+		// index of the entry + 1, 0 if the slot is empty
+		uint32_t entry;
+	};
+
+	struct Shard
+	{
+		std::mutex mutex;
+		std::vector<Entry> entries;
+		std::vector<Slot> index;
+		size_t hand = 0;
+		Statistics statistics;
+	};
+
+	size_t shardCapacity;
+	size_t shardMask;
+	std::vector<std::unique_ptr<Shard>> shards;
+
+	Shard& ShardOf(uint64_t hash) { return *shards[static_cast<size_t>(hash >> 32) & shardMask]; }
+
+	// the slot of a key, or the empty slot where it would go, the mutex of the shard must be held
+	static Slot& Probe(Shard& shard, uint64_t hash, const char* directory, size_t directoryLength, const ResourcePath& relative);
+
+	// double the index of a shard
+	static void Grow(Shard& shard);
+
+	// pick the entry to replace with the clock hand and remove it from the index
+	static size_t Evict(Shard& shard);
+};
@@ -0,0 +1,218 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "ResourcePath.hpp"
+
+// a map from ResourcePath to T organized by path segments, one node per directory
+// everything under a directory is found by walking its subtree, without looking at the other paths
+// a directory path and the same path without the trailing separator are the same key
+template <typename T> class ResourcePathTrie
+{
+public:
+	struct Entry
+	{
+		const ResourcePath key;
+		T value;
+
+		explicit Entry(const ResourcePath& key) : key(key), value() { }
+	};
+
+	ResourcePathTrie() { }
+
+	ResourcePathTrie(const ResourcePathTrie& other) = delete;
+	ResourcePathTrie& operator=(const ResourcePathTrie& other) = delete;
+
+	// find an entry, returns nullptr if not found
+	Entry* Find(const ResourcePath& key)
+	{
+		auto node = Walk(key, false);
+		return node == nullptr ? nullptr : node->entry.get();
+	}
+
+	// insert a default constructed value if the key is not there yet, second is true if it was inserted
+	// the address of an entry doesn't change until it is erased
+	std::pair<Entry*, bool> Insert(const ResourcePath& key)
+	{
+		auto node = Walk(key, true);
+		if (node->entry != nullptr)
+		{
+			return std::make_pair(node->entry.get(), false);
+		}
+		node->entry.reset(new Entry(key));
+		count++;
+		return std::make_pair(node->entry.get(), true);
+	}
+
+	// returns false if the key was not found
+	bool Erase(const ResourcePath& key)
+	{
+		auto node = Walk(key, false);
+		if (node == nullptr || node->entry == nullptr)
+		{
+			return false;
+		}
+		node->entry.reset();
+		count--;
+		Prune(node);
+		return true;
+	}
+
+	// the entry of the key itself or of the nearest directory above it which has an entry, nullptr if none does
+	Entry* FindLongestPrefix(const ResourcePath& key)
+	{
+		Node* node = &root;
+		Entry* found = root.entry.get();
+		std::string segment;
+		for (auto position = key.ToCharPtr(); NextSegment(position, segment);)
+		{
+			auto child = node->children.find(segment);
+			if (child == node->children.end())
+			{
+				break;
+			}
+			node = child->second.get();
+			if (node->entry != nullptr)
+			{
+				found = node->entry.get();
+			}
+		}
+		return found;
+	}
+
+	// call f(Entry&) for the directory itself and every entry under it, f must not modify the trie
+	template <typename F> void ForEachUnder(const ResourcePath& directory, F f)
+	{
+		auto node = Walk(directory, false);
+		if (node != nullptr)
+		{
+			Visit(*node, f);
+		}
+	}
+
+	// erase the directory and everything under it, returns the number of erased entries
+	size_t EraseUnder(const ResourcePath& directory)
+	{
+		auto node = Walk(directory, false);
+		if (node == nullptr)
+		{
+			return 0;
+		}
+		size_t erased = 0;
+		auto countEntry = [&](Entry&) { erased++; };
+		Visit(*node, countEntry);
+		count -= erased;
+		node->entry.reset();
+		node->children.clear();
+		Prune(node);
+		return erased;
+	}
+
+	size_t Size() const
+	{
+		return count;
+	}
+
+	void Clear()
+	{
+		root.entry.reset();
+		root.children.clear();
+		count = 0;
+	}
+
+private:
+	struct Node
+	{
+		Node* parent = nullptr;
+		std::string segment;
+		std::unordered_map<std::string, std::unique_ptr<Node>> children;
+		std::unique_ptr<Entry> entry;
+	};
+
+	Node root;
+	size_t count = 0;
+
+	// copy the next segment to segment and advance past it, empty segments are skipped
+	// so a trailing separator doesn't make a different key, returns false at the end of the path
+	static bool NextSegment(const char*& position, std::string& segment)
+	{
+		while (*position == '/')
+		{
+			position++;
+		}
+		if (*position == 0)
+		{
+			return false;
+		}
+		auto begin = position;
+		while (*position != 0 && *position != '/')
+		{
+			position++;
+		}
+		// assign reuses the capacity of segment, so walking doesn't allocate for every segment
+		segment.assign(begin, position);
+		return true;
+	}
+
+	Node* Walk(const ResourcePath& key, bool create)
+	{
+		Node* node = &root;
+		std::string segment;
+		for (auto position = key.ToCharPtr(); NextSegment(position, segment);)
+		{
+			auto child = node->children.find(segment);
+			if (child != node->children.end())
+			{
+				node = child->second.get();
+			}
+			else if (create)
+			{
+				std::unique_ptr<Node> created(new Node());
+				created->parent = node;
+				created->segment = segment;
+				auto next = created.get();
+				node->children.emplace(segment, std::move(created));
+				node = next;
+			}
+			else
+			{
+				return nullptr;
+			}
+		}
+		return node;
+	}
+
+	// remove nodes which have no entry and no children, from node up to the root
+	void Prune(Node* node)
+	{
+		while (node != &root && node->entry == nullptr && node->children.empty())
+		{
+			auto parent = node->parent;
+			// the key is copied, erasing destroys the node which owns the segment
+			std::string segment = node->segment;
+			parent->children.erase(segment);
+			node = parent;
+		}
+	}
+
+	template <typename F> static void Visit(Node& start, F& f)
+	{
+		// explicit stack, paths can be deep
+		std::vector<Node*> stack(1, &start);
+		while (!stack.empty())
+		{
+			auto node = stack.back();
+			stack.pop_back();
+			if (node->entry != nullptr)
+			{
+				f(*node->entry);
+			}
+			for (auto& child : node->children)
+			{
+				stack.push_back(child.second.get());
+			}
+		}
+	}
+};
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// a named block of memory which other processes on the same machine can map by its name
+// the block exists while any process has it mapped, new blocks are filled with zeros
+class SharedMemory
+{
+public:
+	// create the block, or open it for writing if another process already created it, then size is ignored
+	// throws std::runtime_error if it can't be created or mapped
+	SharedMemory(const std::string& name, size_t size);
+
+	// open a block which another process created, for reading only
+	// if it doesn't exist then IsOpen returns false, other errors throw std::runtime_error
+	explicit SharedMemory(const std::string& name);
+
+	SharedMemory(const SharedMemory& other) = delete;
+	SharedMemory& operator=(const SharedMemory& other) = delete;
+
+	~SharedMemory();
+
+	bool IsOpen() const { return data != nullptr; }
+
+	// true if this object created the block, false if it was opened
+	bool IsCreated() const { return isCreated; }
+
+	bool IsReadOnly() const { return isReadOnly; }
+
+	// start of the block, it must not be written if it's read only
+	char* Data() const { return data; }
+
+	size_t Size() const { return size; }
+
+private:
+	bool isCreated = false;
+	bool isReadOnly = false;
+	char* data = nullptr;
+	size_t size = 0;
+	void* mappingHandle = nullptr;
+};
@@ -0,0 +1,198 @@
+#include "SharedResourceCache.hpp"
+#include "ContentHash.hpp"
+#include "SharedMemory.hpp"
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+static const char CacheMagic[4] = { 'R', 'S', 'H', 'C' };
+static const uint64_t CacheAlignment = 16;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "shared memory needs lock free 64 bit atomics to work across processes");
+
+static uint64_t Align(uint64_t value)
+{
+	return (value + CacheAlignment - 1) & ~(CacheAlignment - 1);
+}
+
+SharedResourceCache::SharedResourceCache(const std::string& name, size_t dataCapacity, uint32_t entryCapacity)
+{
+	if (entryCapacity == 0 || (entryCapacity & (entryCapacity - 1)) != 0)
+	{
+		throw std::logic_error("SharedResourceCache entry capacity must be a power of 2");
+	}
+	uint64_t dataOffset = Align(sizeof(Header) + sizeof(Entry) * static_cast<uint64_t>(entryCapacity));
+	memory = std::make_shared<SharedMemory>(name, static_cast<size_t>(dataOffset + dataCapacity));
+	header = reinterpret_cast<Header*>(memory->Data());
+	if (memory->IsCreated())
+	{
+		// the memory is zero filled, so unused entries are already empty
+		new (header) Header();
+		std::memcpy(header->magic, CacheMagic, sizeof(CacheMagic));
+		header->version = Version;
+		header->entryCapacity = entryCapacity;
+		header->dataOffset = dataOffset;
+		header->dataCapacity = dataCapacity;
+		header->dataUsed = 0;
+		for (uint32_t i = 0; i < entryCapacity; i++)
+		{
+			new (reinterpret_cast<Entry*>(memory->Data() + sizeof(Header)) + i) Entry();
+		}
+		header->initialized.store(1, std::memory_order_release);
+	}
+	else if (header->initialized.load(std::memory_order_acquire) == 0 || std::memcmp(header->magic, CacheMagic, sizeof(CacheMagic)) != 0 || header->version != Version)
+	{
+		throw std::runtime_error("Shared memory is not a valid resource cache: " + name);
+	}
+	entries = reinterpret_cast<Entry*>(memory->Data() + sizeof(Header));
+	data = memory->Data() + header->dataOffset;
+}
+
+SharedResourceCache::SharedResourceCache(const std::string& name)
+{
+	memory = std::make_shared<SharedMemory>(name);
+	if (!memory->IsOpen())
+	{
+		throw std::runtime_error("Shared resource cache not found: " + name);
+	}
+	header = reinterpret_cast<Header*>(memory->Data());
+	if (memory->Size() < sizeof(Header) || header->initialized.load(std::memory_order_acquire) == 0
+		|| std::memcmp(header->magic, CacheMagic, sizeof(CacheMagic)) != 0 || header->version != Version
+		|| header->dataOffset + header->dataCapacity > memory->Size())
+	{
+		throw std::runtime_error("Shared memory is not a valid resource cache: " + name);
+	}
+	entries = reinterpret_cast<Entry*>(memory->Data() + sizeof(Header));
+	data = memory->Data() + header->dataOffset;
+}
+
+// defined here where SharedMemory is complete
+SharedResourceCache::~SharedResourceCache()
+{
+}
+
+bool SharedResourceCache::IsWritable() const
+{
+	return !memory->IsReadOnly();
+}
+
+std::string SharedResourceCache::Key(const std::string& type, const ResourcePath& path)
+{
+	std::string key = type;
+	key += '\0';
+	key += path.ToCharPtr();
+	return key;
+}
+
+SharedResourceCache::Entry* SharedResourceCache::Probe(const std::string& key, uint64_t hash) const
+{
+	uint32_t mask = header->entryCapacity - 1;
+	for (uint32_t probe = 0; probe <= mask; probe++)
+	{
+		auto& entry = entries[(hash + probe) & mask];
+		uint64_t entryHash = entry.keyHash.load(std::memory_order_acquire);
+		if (entryHash == 0)
+		{
+			return &entry;
+		}
+		if (entryHash == hash && entry.keyLength == key.size() && std::memcmp(data + entry.keyOffset, key.data(), key.size()) == 0)
+		{
+			return &entry;
+		}
+	}
+	return nullptr;
+}
+
+static uint64_t KeyHash(const std::string& key)
+{
+	// 0 marks unused entries
+	uint64_t hash = ContentHash(key.data(), key.size());
+	return hash == 0 ? 1 : hash;
+}
+
+ResourceData SharedResourceCache::Find(const std::string& type, const ResourcePath& path, uint64_t& version) const
+{
+	auto key = Key(type, path);
+	auto entry = Probe(key, KeyHash(key));
+	if (entry == nullptr || entry->keyHash.load(std::memory_order_acquire) == 0)
+	{
+		return ResourceData();
+	}
+	// retry if the writer published a new version while the location was read
+	uint64_t before, offset, size;
+	do
+	{
+		before = entry->sequence.load(std::memory_order_acquire);
+		offset = entry->dataOffset.load(std::memory_order_relaxed);
+		size = entry->dataSize.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+	} while ((before & 1) != 0 || entry->sequence.load(std::memory_order_relaxed) != before);
+	version = before / 2;
+	return ResourceData(data + offset, static_cast<size_t>(size), memory);
+}
+
+ResourceData SharedResourceCache::Store(const std::string& type, const ResourcePath& path, const std::string& bytes, uint64_t& version)
+{
+	if (!IsWritable())
+	{
+		return ResourceData();
+	}
+	std::lock_guard<std::mutex> guard(writeMutex);
+	auto key = Key(type, path);
+	uint64_t hash = KeyHash(key);
+	auto entry = Probe(key, hash);
+	if (entry == nullptr)
+	{
+		return ResourceData();
+	}
+	bool isNew = entry->keyHash.load(std::memory_order_relaxed) == 0;
+
+	// append the key of a new entry and the bytes, nothing is overwritten so readers of older versions are not disturbed
+	uint64_t used = header->dataUsed.load(std::memory_order_relaxed);
+	uint64_t keyOffset = used;
+	uint64_t dataOffset = isNew ? Align(keyOffset + key.size()) : used;
+	uint64_t end = Align(dataOffset + bytes.size());
+	if (end > header->dataCapacity)
+	{
+		return ResourceData();
+	}
+	if (isNew)
+	{
+		std::memcpy(data + keyOffset, key.data(), key.size());
+	}
+	std::memcpy(data + dataOffset, bytes.data(), bytes.size());
+	header->dataUsed.store(end, std::memory_order_relaxed);
+
+	if (isNew)
+	{
+		entry->keyOffset = keyOffset;
+		entry->keyLength = key.size();
+		entry->dataOffset.store(dataOffset, std::memory_order_relaxed);
+		entry->dataSize.store(bytes.size(), std::memory_order_relaxed);
+		entry->sequence.store(2, std::memory_order_relaxed);
+		// readers find the entry only after everything above is visible
+		entry->keyHash.store(hash, std::memory_order_release);
+		version = 1;
+	}
+	else
+	{
+		uint64_t sequence = entry->sequence.load(std::memory_order_relaxed);
+		entry->sequence.store(sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		entry->dataOffset.store(dataOffset, std::memory_order_relaxed);
+		entry->dataSize.store(bytes.size(), std::memory_order_relaxed);
+		entry->sequence.store(sequence + 2, std::memory_order_release);
+		version = sequence / 2 + 1;
+	}
+	return ResourceData(data + dataOffset, bytes.size(), memory);
+}
+
+size_t SharedResourceCache::DataUsed() const
+{
+	return static_cast<size_t>(header->dataUsed.load(std::memory_order_relaxed));
+}
+
+size_t SharedResourceCache::DataCapacity() const
+{
+	return static_cast<size_t>(header->dataCapacity);
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "ResourcePath.hpp"
+#include "ResourcePack.hpp"
+
+class SharedMemory;
+
+// flat resource data shared between processes on the same machine, see FlatResourceFactory
+// one process creates the cache and builds the resources into it, the others attach to it for reading only,
+// so each resource is in memory once no matter how many processes use it
+//
+// the data is only ever appended, a rebuilt resource gets a new copy and its entry points to it,
+// so views of the previous version stay valid, space is reclaimed when every process has closed the cache
+//
+// layout of the shared memory:
+//   header:  char magic[4] "RSHC", uint32 version, uint32 entryCapacity, uint32 initialized,
+//            uint64 dataOffset, uint64 dataCapacity, uint64 dataUsed
+//   entries: entryCapacity times Entry, an open addressing table keyed by the hash of type and path
+//   data:    keys and resource bytes, each starting at a multiple of 16
+class SharedResourceCache
+{
+public:
+	struct Header
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t entryCapacity;
+		std::atomic<uint32_t> initialized;
+		uint64_t dataOffset;
+		uint64_t dataCapacity;
+		std::atomic<uint64_t> dataUsed;
+	};
+
+	// the creator writes all fields before publishing keyHash, after that only the location of the data changes
+	struct Entry
+	{
+		std::atomic<uint64_t> keyHash; // 0 while the entry is unused
+		// even while the entry is stable, odd while a new version is being published
+		std::atomic<uint64_t> sequence;
+		std::atomic<uint64_t> dataOffset;
+		std::atomic<uint64_t> dataSize;
+		uint64_t keyOffset;
+		uint64_t keyLength;
+	};
+
+	static const uint32_t Version = 1;
+
+	// create the cache for writing, only one process may write to a cache
+	// if readers still keep a cache of the same name open, it's opened and its contents are kept
+	// throws std::runtime_error if the shared memory can't be created or the existing one is not a valid cache
+	SharedResourceCache(const std::string& name, size_t dataCapacity, uint32_t entryCapacity = 65536);
+
+	// attach to a cache created by another process, for reading only
+	// throws std::runtime_error if it doesn't exist or is not a valid cache
+	explicit SharedResourceCache(const std::string& name);
+
+	~SharedResourceCache();
+
+	SharedResourceCache(const SharedResourceCache& other) = delete;
+	SharedResourceCache& operator=(const SharedResourceCache& other) = delete;
+
+	// true for the process which builds resources into the cache
+	bool IsWritable() const;
+
+	// get the current bytes of a resource, a null ResourceData if it's not in the cache
+	// version is incremented every time the resource is stored again
+	ResourceData Find(const std::string& type, const ResourcePath& path, uint64_t& version) const;
+
+	// copy the bytes of a resource into the cache, replacing the previous version, version is set to the new one
+	// returns a view of the shared copy, or a null ResourceData if the cache is full or read only
+	ResourceData Store(const std::string& type, const ResourcePath& path, const std::string& bytes, uint64_t& version);
+
+	// bytes of the data area in use, including replaced versions
+	size_t DataUsed() const;
+
+	size_t DataCapacity() const;
+
+private:
+	std::shared_ptr<SharedMemory> memory;
+	Header* header;
+	Entry* entries;
+	char* data;
+	// the writing process has one writer at a time, readers don't take it
+	std::mutex writeMutex;
+
+	static std::string Key(const std::string& type, const ResourcePath& path);
+
+	// find the entry of a key, or the empty entry where it would go, nullptr if the table is full
+	Entry* Probe(const std::string& key, uint64_t hash) const;
+};
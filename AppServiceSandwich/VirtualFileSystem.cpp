@@ -0,0 +1,228 @@
+#include "VirtualFileSystem.hpp"
+#include "FileMapping.hpp"
+#include <algorithm>
+
+static ResourceData ReadFile(const std::string& fileName)
+{
+	auto mapping = std::make_shared<FileMapping>(fileName);
+	if (!mapping->IsOpen())
+	{
+		return ResourceData();
+	}
+	return ResourceData(mapping->Data(), mapping->Size(), mapping);
+}
+
+static bool StartsWith(const std::string& text, const std::string& prefix)
+{
+	return text.size() >= prefix.size() && text.compare(0, prefix.size(), prefix) == 0;
+}
+
+static std::string DirectoryString(const ResourcePath& path)
+{
+	auto text = path.ToString();
+	if (!path.IsDirectoryPath())
+	{
+		text += '/';
+	}
+	return text;
+}
+
+DirectoryMount::DirectoryMount()
+{
+}
+
+DirectoryMount::DirectoryMount(const ResourcePath& directory, const ResourcePath& mountedAt)
+	: directory(DirectoryString(directory)), mountedAt(DirectoryString(mountedAt))
+{
+}
+
+ResourceData DirectoryMount::Read(const ResourcePath& path)
+{
+	if (mountedAt.size() == 0)
+	{
+		return ReadFile(path.ToString());
+	}
+	auto text = path.ToString();
+	if (!StartsWith(text, mountedAt))
+	{
+		return ResourceData();
+	}
+	return ReadFile(directory + text.substr(mountedAt.size()));
+}
+
+bool DirectoryMount::ToVirtualPath(const ResourcePath& file, ResourcePath& path) const
+{
+	if (mountedAt.size() == 0)
+	{
+		path = file;
+		return true;
+	}
+	auto text = file.ToString();
+	if (!StartsWith(text, directory))
+	{
+		return false;
+	}
+	path = ResourcePath(mountedAt + text.substr(directory.size()));
+	return true;
+}
+
+ResourceData PackMount::Read(const ResourcePath& path)
+{
+	const char* data;
+	size_t size;
+	if (!pack->Find(path, data, size))
+	{
+		return ResourceData();
+	}
+	// the view keeps the pack mapped, even if it's unmounted later
+	return ResourceData(data, size, pack);
+}
+
+void MemoryMount::Write(const ResourcePath& path, std::string contents)
+{
+	auto file = std::make_shared<const std::string>(std::move(contents));
+	std::lock_guard<std::mutex> guard(mutex);
+	files[path] = file;
+}
+
+bool MemoryMount::Remove(const ResourcePath& path)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	return files.erase(path) > 0;
+}
+
+ResourceData MemoryMount::Read(const ResourcePath& path)
+{
+	std::shared_ptr<const std::string> file;
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		auto found = files.find(path);
+		if (found == files.end())
+		{
+			return ResourceData();
+		}
+		file = found->second;
+	}
+	// readers keep their version even if it's overwritten meanwhile
+	return ResourceData(file->data(), file->size(), file);
+}
+
+void VirtualFileSystem::Mount(std::shared_ptr<MountPoint> mount, int priority)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	auto position = std::find_if(mounts.begin(), mounts.end(), [=](const Mounted& mounted) { return mounted.priority <= priority; });
+	mounts.insert(position, Mounted{ std::move(mount), priority });
+	cache.Clear();
+	epoch++;
+}
+
+bool VirtualFileSystem::Unmount(const std::shared_ptr<MountPoint>& mount)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	auto position = std::find_if(mounts.begin(), mounts.end(), [&](const Mounted& mounted) { return mounted.mount == mount; });
+	if (position == mounts.end())
+	{
+		return false;
+	}
+	mounts.erase(position);
+	cache.Clear();
+	epoch++;
+	return true;
+}
+
+ResourceData VirtualFileSystem::Read(const ResourcePath& path)
+{
+	size_t hash = ResourcePathMap<int>::Hash(path);
+	std::shared_ptr<MountPoint> cachedMount;
+	std::vector<Mounted> searched;
+	unsigned long long startEpoch;
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		statistics.lookups++;
+		auto entry = cache.Find(path, hash);
+		if (entry != nullptr)
+		{
+			statistics.cacheHits++;
+			if (entry->value == NotFound)
+			{
+				statistics.cachedMisses++;
+				return ResourceData();
+			}
+			statistics.probes++;
+			cachedMount = mounts[entry->value].mount;
+		}
+		else
+		{
+			searched = mounts;
+		}
+		startEpoch = epoch;
+	}
+
+	if (cachedMount != nullptr)
+	{
+		auto data = cachedMount->Read(path);
+		if (!data.IsNull())
+		{
+			return data;
+		}
+		// it was removed without a notification, search all mounts again
+		std::lock_guard<std::mutex> guard(mutex);
+		searched = mounts;
+		startEpoch = epoch;
+	}
+
+	// mounts are read without holding the lock, since reading can take a while
+	int found = NotFound;
+	ResourceData data;
+	for (size_t i = 0; i < searched.size(); i++)
+	{
+		data = searched[i].mount->Read(path);
+		if (!data.IsNull())
+		{
+			found = static_cast<int>(i);
+			break;
+		}
+	}
+
+	std::lock_guard<std::mutex> guard(mutex);
+	statistics.probes += found == NotFound ? searched.size() : found + 1;
+	if (epoch == startEpoch)
+	{
+		cache.Insert(path, hash).first->value = found;
+	}
+	return data;
+}
+
+void VirtualFileSystem::Invalidate(const ResourcePath& path)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	epoch++;
+	cache.Erase(path);
+	for (auto& mounted : mounts)
+	{
+		ResourcePath virtualPath;
+		if (mounted.mount->ToVirtualPath(path, virtualPath) && virtualPath != path)
+		{
+			cache.Erase(virtualPath);
+		}
+	}
+}
+
+void VirtualFileSystem::InvalidateAll()
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	epoch++;
+	cache.Clear();
+}
+
+size_t VirtualFileSystem::CacheSize()
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	return cache.Size();
+}
+
+VirtualFileSystem::Statistics VirtualFileSystem::GetStatistics()
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	return statistics;
+}
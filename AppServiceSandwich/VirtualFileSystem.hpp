@@ -0,0 +1,124 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ResourcePath.hpp"
+#include "ResourcePathMap.hpp"
+#include "ResourcePack.hpp"
+
+// a source of resource contents which can be mounted into a VirtualFileSystem
+class MountPoint
+{
+public:
+	virtual ~MountPoint() { }
+
+	// read a resource by its virtual path, returns a null ResourceData if this mount doesn't have it
+	virtual ResourceData Read(const ResourcePath& path) = 0;
+
+	// translate a changed file on disk to the virtual path it's visible as, false if it's not part of this mount
+	virtual bool ToVirtualPath(const ResourcePath& /*file*/, ResourcePath& /*path*/) const { return false; }
+};
+
+// files in a directory on disk, a virtual path under mountedAt is read from the same relative path under directory
+class DirectoryMount : public MountPoint
+{
+public:
+	// every path is read from the same path on disk, relative to the working directory
+	DirectoryMount();
+
+	DirectoryMount(const ResourcePath& directory, const ResourcePath& mountedAt = ResourcePath());
+
+	ResourceData Read(const ResourcePath& path) override;
+
+	bool ToVirtualPath(const ResourcePath& file, ResourcePath& path) const override;
+
+private:
+	std::string directory;
+	std::string mountedAt;
+};
+
+// the contents of a ResourcePack, paths in the pack are the virtual paths
+class PackMount : public MountPoint
+{
+public:
+	explicit PackMount(std::shared_ptr<ResourcePack> pack) : pack(std::move(pack)) { }
+
+	ResourceData Read(const ResourcePath& path) override;
+
+private:
+	std::shared_ptr<ResourcePack> pack;
+};
+
+// resources kept in memory, usually mounted above the others to override files without touching the disk
+// after changing it call ResourceManager::NotifyResourceChange with the path, so cached lookups are updated
+class MemoryMount : public MountPoint
+{
+public:
+	void Write(const ResourcePath& path, std::string contents);
+
+	// returns false if there was nothing to remove
+	bool Remove(const ResourcePath& path);
+
+	ResourceData Read(const ResourcePath& path) override;
+
+private:
+	std::mutex mutex;
+	std::unordered_map<ResourcePath, std::shared_ptr<const std::string>, ResourcePath::Hasher> files;
+};
+
+// resolves virtual paths through an ordered list of mount points
+// where each path was found is cached, and so are paths which were not found anywhere,
+// so repeated lookups don't probe every mount again, call Invalidate when something changes
+class VirtualFileSystem
+{
+public:
+	struct Statistics
+	{
+		unsigned long long lookups = 0;
+		// lookups answered by the cache, including cached misses
+		unsigned long long cacheHits = 0;
+		unsigned long long cachedMisses = 0;
+		// how many times a mount was asked for a path
+		unsigned long long probes = 0;
+	};
+
+	// mounts with higher priority are searched first, with equal priority the one mounted later is searched first
+	void Mount(std::shared_ptr<MountPoint> mount, int priority = 0);
+
+	// returns false if it was not mounted
+	bool Unmount(const std::shared_ptr<MountPoint>& mount);
+
+	// read a resource from the first mount which has it, returns a null ResourceData if none has it
+	ResourceData Read(const ResourcePath& path);
+
+	bool Exists(const ResourcePath& path) { return !Read(path).IsNull(); }
+
+	// forget what is cached for a path, called with a virtual path or with a changed file on disk
+	void Invalidate(const ResourcePath& path);
+
+	void InvalidateAll();
+
+	// number of cached paths, found or not
+	size_t CacheSize();
+
+	Statistics GetStatistics();
+
+private:
+	static const int NotFound = -1;
+
+	struct Mounted
+	{
+		std::shared_ptr<MountPoint> mount;
+		int priority;
+	};
+
+	std::mutex mutex;
+	std::vector<Mounted> mounts; // in search order
+	// path -> index in mounts or NotFound, cleared when the mounts change
+	ResourcePathMap<int> cache;
+	// incremented by every invalidation, a lookup only caches its result if nothing was invalidated meanwhile
+	unsigned long long epoch = 0;
+	Statistics statistics;
+};
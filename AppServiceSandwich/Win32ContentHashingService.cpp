@@ -0,0 +1,41 @@
+#include <Windows.h>
+#include "Win32ContentHashingService.hpp"
+#include "ContentHash.hpp"
+
+unsigned long long Win32ContentHashingService::GetFileContentHash(const ResourcePath& filePath)
+{
+	auto file = CreateFileA(filePath.ToCharPtr(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+	                        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		// missing or locked by the writer, either way we can't tell if it changed
+		return 0;
+	}
+	unsigned long long hash = 0;
+	LARGE_INTEGER size;
+	if (GetFileSizeEx(file, &size))
+	{
+		if (size.QuadPart == 0)
+		{
+			// empty files can't be mapped
+			hash = ContentHash(nullptr, 0);
+		}
+		else if (static_cast<unsigned long long>(size.QuadPart) <= static_cast<size_t>(-1))
+		{
+			auto mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (mapping != nullptr)
+			{
+				auto view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+				if (view != nullptr)
+				{
+					hash = ContentHash(view, static_cast<size_t>(size.QuadPart));
+					UnmapViewOfFile(view);
+				}
+				CloseHandle(mapping);
+			}
+		}
+	}
+	CloseHandle(file);
+	// 0 is reserved for no information
+	return hash == 0 ? 1 : hash;
+}
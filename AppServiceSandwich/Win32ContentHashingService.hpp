@@ -0,0 +1,10 @@
+#pragma once
+#include "IContentHashingService.hpp"
+
+// hashes the file through a read only memory mapping, so the contents are not copied
+class Win32ContentHashingService : public IContentHashingService
+{
+public:
+	unsigned long long GetFileContentHash(const ResourcePath& filePath) override;
+	~Win32ContentHashingService() {};
+};
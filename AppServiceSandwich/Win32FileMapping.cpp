@@ -0,0 +1,77 @@
+#include <Windows.h>
+#include <stdexcept>
+#include "FileMapping.hpp"
+
+static std::string LastErrorMessage(const char* function)
+{
+	char message[4096];
+	FormatMessageA(FORMAT_MESSAGE_FROM_SYSTEM, nullptr, GetLastError(), LANG_SYSTEM_DEFAULT, message, 4096, nullptr);
+	return std::string(function) + " failed, " + message;
+}
+
+FileMapping::FileMapping(const std::string& fileName)
+{
+	auto file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		auto error = GetLastError();
+		if (error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND)
+		{
+			return;
+		}
+		throw std::runtime_error(LastErrorMessage("CreateFileA"));
+	}
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize))
+	{
+		auto message = LastErrorMessage("GetFileSizeEx");
+		CloseHandle(file);
+		throw std::runtime_error(message);
+	}
+	if (static_cast<unsigned long long>(fileSize.QuadPart) > static_cast<size_t>(-1))
+	{
+		CloseHandle(file);
+		throw std::runtime_error("File is too large to be mapped: " + fileName);
+	}
+	fileHandle = file;
+	isOpen = true;
+	size = static_cast<size_t>(fileSize.QuadPart);
+	if (size == 0)
+	{
+		// empty files can't be mapped
+		return;
+	}
+	auto mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr)
+	{
+		auto message = LastErrorMessage("CreateFileMappingA");
+		CloseHandle(file);
+		throw std::runtime_error(message);
+	}
+	auto view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == nullptr)
+	{
+		auto message = LastErrorMessage("MapViewOfFile");
+		CloseHandle(mapping);
+		CloseHandle(file);
+		throw std::runtime_error(message);
+	}
+	mappingHandle = mapping;
+	data = static_cast<const char*>(view);
+}
+
+FileMapping::~FileMapping()
+{
+	if (data != nullptr)
+	{
+		UnmapViewOfFile(data);
+	}
+	if (mappingHandle != nullptr)
+	{
+		CloseHandle(mappingHandle);
+	}
+	if (fileHandle != nullptr)
+	{
+		CloseHandle(fileHandle);
+	}
+}
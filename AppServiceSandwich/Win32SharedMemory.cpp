@@ -0,0 +1,80 @@
+#include <Windows.h>
+#include <stdexcept>
+#include "SharedMemory.hpp"
+
+static std::string LastErrorMessage(const char* function)
+{
+	char message[4096];
+	FormatMessageA(FORMAT_MESSAGE_FROM_SYSTEM, nullptr, GetLastError(), LANG_SYSTEM_DEFAULT, message, 4096, nullptr);
+	return std::string(function) + " failed, " + message;
+}
+
+// the size of a view opened by name is not known, the region of the view tells it
+static size_t ViewSize(const void* view)
+{
+	MEMORY_BASIC_INFORMATION information;
+	if (VirtualQuery(view, &information, sizeof(information)) == 0)
+	{
+		throw std::runtime_error(LastErrorMessage("VirtualQuery"));
+	}
+	return information.RegionSize;
+}
+
+SharedMemory::SharedMemory(const std::string& name, size_t size)
+{
+	auto large = static_cast<unsigned long long>(size);
+	// backed by the paging file, so it's not written to disk unless memory runs low
+	auto mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+		static_cast<DWORD>(large >> 32), static_cast<DWORD>(large & 0xffffffff), name.c_str());
+	if (mapping == nullptr)
+	{
+		throw std::runtime_error(LastErrorMessage("CreateFileMappingA"));
+	}
+	isCreated = GetLastError() != ERROR_ALREADY_EXISTS;
+	auto view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+	if (view == nullptr)
+	{
+		auto message = LastErrorMessage("MapViewOfFile");
+		CloseHandle(mapping);
+		throw std::runtime_error(message);
+	}
+	mappingHandle = mapping;
+	data = static_cast<char*>(view);
+	this->size = isCreated ? size : ViewSize(view);
+}
+
+SharedMemory::SharedMemory(const std::string& name)
+{
+	isReadOnly = true;
+	auto mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+	if (mapping == nullptr)
+	{
+		if (GetLastError() == ERROR_FILE_NOT_FOUND)
+		{
+			return;
+		}
+		throw std::runtime_error(LastErrorMessage("OpenFileMappingA"));
+	}
+	auto view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == nullptr)
+	{
+		auto message = LastErrorMessage("MapViewOfFile");
+		CloseHandle(mapping);
+		throw std::runtime_error(message);
+	}
+	mappingHandle = mapping;
+	data = static_cast<char*>(view);
+	size = ViewSize(view);
+}
+
+SharedMemory::~SharedMemory()
+{
+	if (data != nullptr)
+	{
+		UnmapViewOfFile(data);
+	}
+	if (mappingHandle != nullptr)
+	{
+		CloseHandle(mappingHandle);
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// collects timings of benchmarks and writes them as JSON
+class BenchmarkReport
+{
+public:
+	struct Result
+	{
+		std::string name;
+		long long parameter; // the size of the workload, for example the number of loaded resources
+		long long iterations;
+		double nanosecondsPerIteration;
+	};
+
+	// only benchmarks which contain this in their name are run, empty runs all of them
+	std::string filter;
+	// smaller workloads, for checking that the benchmarks work at all
+	bool quick = false;
+
+	bool IsEnabled(const std::string& name) const
+	{
+		return filter.size() == 0 || name.find(filter) != std::string::npos;
+	}
+
+	// call operation(i) for each iteration and record the average time of one call
+	template <typename F> void Measure(const std::string& name, long long parameter, long long iterations, F operation)
+	{
+		auto start = std::chrono::steady_clock::now();
+		for (long long i = 0; i < iterations; i++)
+		{
+			operation(i);
+		}
+		auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+		Record(name, parameter, iterations, static_cast<double>(nanoseconds) / (iterations > 0 ? iterations : 1));
+	}
+
+	void Record(const std::string& name, long long parameter, long long iterations, double nanosecondsPerIteration)
+	{
+		results.push_back(Result{ name, parameter, iterations, nanosecondsPerIteration });
+	}
+
+	std::string ToJson() const
+	{
+		std::ostringstream out;
+		out << "[";
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			auto& result = results[i];
+			out << (i == 0 ? "\n" : ",\n");
+			out << "{\"name\": \"" << result.name << "\", \"parameter\": " << result.parameter
+				<< ", \"iterations\": " << result.iterations << ", \"ns_per_iteration\": " << result.nanosecondsPerIteration << "}";
+		}
+		out << "\n]\n";
+		return out.str();
+	}
+
+private:
+	std::vector<Result> results;
+};
+
+// results are added here so that the compiler can't throw away the measured work
+extern volatile long long benchmarkSink;
+
+void RunResourceManagerBenchmarks(BenchmarkReport& report);
@@ -0,0 +1,26 @@
+#include "Benchmark.hpp"
+#include <iostream>
+
+volatile long long benchmarkSink = 0;
+
+// usage: BenchmarkAppServiceSandwich [--quick] [name filter]
+// prints the results as a JSON array to the standard output
+int main(int argc, char** argv)
+{
+	BenchmarkReport report;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--quick")
+		{
+			report.quick = true;
+		}
+		else
+		{
+			report.filter = argument;
+		}
+	}
+	RunResourceManagerBenchmarks(report);
+	std::cout << report.ToJson();
+	return 0;
+}
@@ -0,0 +1,719 @@
+#include "Benchmark.hpp"
+#include "ResourceManager.hpp"
+#include "ResourcePathPattern.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+	// everything is built in memory so that only the manager is measured, not the disk
+
+	class Blob : public ManagedResource
+	{
+	public:
+		long long value;
+
+		explicit Blob(long long value) : value(value) { }
+	};
+
+	class BlobFactory : public ResourceFactory
+	{
+	public:
+		long long counter = 0;
+
+		ManagedResource* operator()(const ResourcePath&, ResourceManagerLocation&) override
+		{
+			return new Blob(++counter);
+		}
+	};
+
+	// a chain link at "<prefix>/<depth>.chain" requires "<depth - 1>.chain" next to it
+	class Chain : public ManagedResource
+	{
+	public:
+		ResourcePtr<Chain> next;
+		long long depth;
+
+		Chain(ResourcePtr<Chain> next, long long depth) : next(next), depth(depth) { }
+	};
+
+	class ChainFactory : public ResourceFactory
+	{
+	public:
+		ManagedResource* operator()(const ResourcePath& path, ResourceManagerLocation& manager) override
+		{
+			std::string text = path.ToString();
+			long long depth = std::atoll(text.c_str() + text.rfind('/') + 1);
+			ResourcePtr<Chain> next;
+			if (depth > 0)
+			{
+				next = manager.Require<Chain>(std::to_string(depth - 1) + ".chain");
+			}
+			return new Chain(next, depth);
+		}
+	};
+
+	// a node of an include tree at "<directory>/node.inc" requires the leaves next to it
+	// and the node one directory deeper, until the depth encoded in the directory name is reached
+	class IncludeNode : public ManagedResource
+	{
+	public:
+		std::vector<ResourcePtr<Blob>> leaves;
+		ResourcePtr<IncludeNode> child;
+	};
+
+	class IncludeNodeFactory : public ResourceFactory
+	{
+	public:
+		long long depth = 0;
+		std::vector<ResourcePath> leafNames;
+
+		ManagedResource* operator()(const ResourcePath& path, ResourceManagerLocation& manager) override
+		{
+			auto node = new IncludeNode();
+			for (auto& leaf : leafNames)
+			{
+				node->leaves.push_back(manager.Require<Blob>(leaf));
+			}
+			// depth is the number of separators after the root directory
+			long long level = 0;
+			for (auto c = path.ToCharPtr(); *c != 0; c++)
+			{
+				level += *c == '/';
+			}
+			if (level < depth + 2)
+			{
+				node->child = manager.Require<IncludeNode>("d/node.inc");
+			}
+			return node;
+		}
+	};
+
+	// file timestamps are whatever the benchmark sets
+	class FakeTimestampingService : public ITimestampingService
+	{
+	public:
+		long long timestamp = 1;
+
+		long long GetFileTimestamp(const ResourcePath&) override
+		{
+			return timestamp;
+		}
+	};
+
+	std::vector<ResourcePath> MakePaths(const std::string& prefix, long long count)
+	{
+		std::vector<ResourcePath> paths;
+		paths.reserve(static_cast<size_t>(count));
+		for (long long i = 0; i < count; i++)
+		{
+			paths.push_back(ResourcePath(prefix + "/" + std::to_string(i % 1000) + "/" + std::to_string(i) + ".bin"));
+		}
+		return paths;
+	}
+
+	// random order so that hits don't walk the storage sequentially
+	std::vector<size_t> MakeShuffledIndices(size_t count, size_t length)
+	{
+		std::mt19937 random(12345);
+		std::uniform_int_distribution<size_t> distribution(0, count - 1);
+		std::vector<size_t> indices(length);
+		for (auto& index : indices)
+		{
+			index = distribution(random);
+		}
+		return indices;
+	}
+
+	void RequireHitAndMiss(BenchmarkReport& report)
+	{
+		long long maximum = report.quick ? 10000 : 1000000;
+		for (long long count = 1000; count <= maximum; count *= 10)
+		{
+			ResourceManager manager;
+			BlobFactory factory;
+			manager.RegisterFactory<Blob>(factory);
+			auto paths = MakePaths("items", count);
+			auto missingPaths = MakePaths("missing", count);
+			std::vector<ResourcePtr<Blob>> keep(static_cast<size_t>(count));
+
+			report.Measure("require_miss", count, count, [&](long long i)
+			{
+				keep[static_cast<size_t>(i)] = manager.Require<Blob>(paths[static_cast<size_t>(i)]);
+			});
+
+			const size_t lookups = 1000000;
+			auto indices = MakeShuffledIndices(static_cast<size_t>(count), lookups);
+			report.Measure("require_hit", count, lookups, [&](long long i)
+			{
+				benchmarkSink += manager.Require<Blob>(paths[indices[static_cast<size_t>(i)]])->value;
+			});
+
+			// a miss in a manager which already holds count resources
+			report.Measure("require_miss_loaded", count, count, [&](long long i)
+			{
+				benchmarkSink += manager.Require<Blob>(missingPaths[static_cast<size_t>(i)])->value;
+			});
+		}
+	}
+
+	void NestedRequire(BenchmarkReport& report)
+	{
+		long long chains = report.quick ? 100 : 10000;
+		for (long long depth = 1; depth <= 64; depth *= 4)
+		{
+			ResourceManager manager;
+			manager.RegisterFactory<Chain, ChainFactory>();
+			std::vector<ResourcePath> heads;
+			for (long long i = 0; i < chains; i++)
+			{
+				heads.push_back(ResourcePath("chains/" + std::to_string(i) + "/" + std::to_string(depth) + ".chain"));
+			}
+			report.Measure("nested_require_chain", depth, chains, [&](long long i)
+			{
+				benchmarkSink += manager.Require<Chain>(heads[static_cast<size_t>(i)])->depth;
+			});
+		}
+	}
+
+	void NotifyChange(BenchmarkReport& report)
+	{
+		long long maximum = report.quick ? 10000 : 1000000;
+		long long notifications = report.quick ? 1000 : 100000;
+		for (long long count = 1000; count <= maximum; count *= 10)
+		{
+			ResourceManager manager;
+			FakeTimestampingService timestamps;
+			manager.UseTimestampingService(&timestamps);
+			BlobFactory factory;
+			manager.RegisterFactory<Blob>(factory);
+			auto paths = MakePaths("items", count);
+			std::vector<ResourcePtr<Blob>> keep;
+			keep.reserve(paths.size());
+			for (auto& path : paths)
+			{
+				keep.push_back(manager.Require<Blob>(path));
+			}
+			auto indices = MakeShuffledIndices(static_cast<size_t>(count), static_cast<size_t>(notifications));
+
+			// file is newer each time, so every notification reloads
+			report.Measure("notify_change_reload", count, notifications, [&](long long i)
+			{
+				timestamps.timestamp++;
+				manager.NotifyResourceChange(paths[indices[static_cast<size_t>(i)]]);
+			});
+
+			// the notification is older than the loaded version, only the lookup and the timestamp query remain
+			long long stale = timestamps.timestamp;
+			timestamps.timestamp = 1;
+			report.Measure("notify_change_stale", count, notifications, [&](long long i)
+			{
+				manager.NotifyResourceChange(paths[indices[static_cast<size_t>(i)]]);
+			});
+			timestamps.timestamp = stale;
+
+			report.Measure("notify_change_not_loaded", count, notifications, [&](long long)
+			{
+				manager.NotifyResourceChange("not/loaded.bin");
+			});
+		}
+	}
+
+	// the changed directory always holds the same resources, only the number of other loaded paths grows
+	void NotifyDirectoryChange(BenchmarkReport& report)
+	{
+		long long maximum = report.quick ? 10000 : 1000000;
+		long long notifications = report.quick ? 100 : 1000;
+		for (long long count = 1000; count <= maximum; count *= 10)
+		{
+			ResourceManager manager;
+			FakeTimestampingService timestamps;
+			manager.UseTimestampingService(&timestamps);
+			BlobFactory factory;
+			manager.RegisterFactory<Blob>(factory);
+			std::vector<ResourcePtr<Blob>> keep;
+			for (auto& path : MakePaths("items", count))
+			{
+				keep.push_back(manager.Require<Blob>(path));
+			}
+			for (int i = 0; i < 100; i++)
+			{
+				keep.push_back(manager.Require<Blob>("level/" + std::to_string(i) + ".bin"));
+			}
+
+			// every notification reloads the 100 resources of the directory
+			report.Measure("notify_directory_reload", count, notifications, [&](long long)
+			{
+				timestamps.timestamp++;
+				manager.NotifyDirectoryChange("level/");
+			});
+
+			report.Measure("notify_directory_not_loaded", count, notifications, [&](long long)
+			{
+				manager.NotifyDirectoryChange("not/loaded/");
+			});
+		}
+	}
+
+	void PointerOperations(BenchmarkReport& report)
+	{
+		long long iterations = report.quick ? 100000 : 10000000;
+		ResourceManager manager;
+		BlobFactory factory;
+		manager.RegisterFactory<Blob>(factory);
+		auto blob = manager.Require<Blob>("blob.bin");
+
+		report.Measure("resource_ptr_copy", 1, iterations, [&](long long)
+		{
+			ResourcePtr<Blob> copy = blob;
+			benchmarkSink += copy.IsNotNull();
+		});
+
+		report.Measure("resource_ptr_deref", 1, iterations, [&](long long)
+		{
+			benchmarkSink += blob->value;
+		});
+
+		auto handle = manager.GetHandle(blob);
+		report.Measure("resource_handle_resolve", 1, iterations, [&](long long)
+		{
+			benchmarkSink += manager.Resolve(handle)->value;
+		});
+
+		// copy and dereference the way most code uses it, through a fresh pointer each time
+		report.Measure("resource_ptr_copy_deref", 1, iterations, [&](long long)
+		{
+			ResourcePtr<Blob> copy = blob;
+			benchmarkSink += copy->value;
+		});
+	}
+
+	struct Setting
+	{
+		long long value;
+	};
+
+	class SettingFactory : public InlineResourceFactory<Setting>
+	{
+	public:
+		long long counter = 0;
+
+		Setting Build(const ResourcePath&, ResourceManagerLocation&) override
+		{
+			return Setting{ ++counter };
+		}
+	};
+
+	// tiny resources stored by value, compared with the same payload as a ManagedResource
+	void InlineResources(BenchmarkReport& report)
+	{
+		long long maximum = report.quick ? 10000 : 1000000;
+		for (long long count = 1000; count <= maximum; count *= 10)
+		{
+			auto paths = MakePaths("settings", count);
+			{
+				ResourceManager manager;
+				SettingFactory factory;
+				manager.RegisterInlineFactory<Setting>(factory);
+				std::vector<InlineResourcePtr<Setting>> keep(static_cast<size_t>(count));
+				report.Measure("inline_require_miss", count, count, [&](long long i)
+				{
+					keep[static_cast<size_t>(i)] = manager.RequireInline<Setting>(paths[static_cast<size_t>(i)]);
+				});
+				report.Measure("inline_get", count, count, [&](long long i)
+				{
+					benchmarkSink += keep[static_cast<size_t>(i)].Get().value;
+				});
+			}
+			{
+				ResourceManager manager;
+				BlobFactory factory;
+				manager.RegisterFactory<Blob>(factory);
+				std::vector<ResourcePtr<Blob>> keep(static_cast<size_t>(count));
+				report.Measure("managed_require_miss", count, count, [&](long long i)
+				{
+					keep[static_cast<size_t>(i)] = manager.Require<Blob>(paths[static_cast<size_t>(i)]);
+				});
+				report.Measure("managed_get", count, count, [&](long long i)
+				{
+					benchmarkSink += keep[static_cast<size_t>(i)]->value;
+				});
+			}
+		}
+	}
+
+	// relative paths required from deep directories, the same pairs repeat the way siblings of a material do
+	void ResolveLocation(BenchmarkReport& report)
+	{
+		long long lookups = report.quick ? 10000 : 1000000;
+		for (long long depth = 1; depth <= 16; depth *= 4)
+		{
+			std::vector<ResourcePath> currentLocations;
+			for (long long i = 0; i < 100; i++)
+			{
+				std::string directory = "assets";
+				for (long long level = 0; level < depth; level++)
+				{
+					directory += "/level" + std::to_string(level);
+				}
+				currentLocations.push_back(ResourcePath(directory + "/material" + std::to_string(i) + ".mat"));
+			}
+			std::vector<ResourcePath> relativePaths;
+			for (long long i = 0; i < 16; i++)
+			{
+				relativePaths.push_back(ResourcePath("textures/texture" + std::to_string(i) + ".png"));
+			}
+
+			report.Measure("resolve_location_uncached", depth, lookups, [&](long long i)
+			{
+				auto path = ResourceManager::ResolveLocation(currentLocations[static_cast<size_t>(i % 100)], relativePaths[static_cast<size_t>(i % 16)]);
+				benchmarkSink += ResourcePathMap<int>::Hash(path);
+			});
+
+			ResourcePathResolver resolver;
+			report.Measure("resolve_location_cached", depth, lookups, [&](long long i)
+			{
+				benchmarkSink += resolver.Resolve(currentLocations[static_cast<size_t>(i % 100)], relativePaths[static_cast<size_t>(i % 16)]).hash;
+			});
+
+			// the same lookups split between threads, the way preload workers resolve nested paths
+			const long long threadCount = 4;
+			auto start = std::chrono::steady_clock::now();
+			std::vector<std::thread> threads;
+			std::vector<size_t> sinks(static_cast<size_t>(threadCount));
+			for (long long t = 0; t < threadCount; t++)
+			{
+				threads.push_back(std::thread([&, t]
+				{
+					size_t sink = 0;
+					for (long long i = t; i < lookups; i += threadCount)
+					{
+						sink += resolver.Resolve(currentLocations[static_cast<size_t>(i % 100)], relativePaths[static_cast<size_t>(i % 16)]).hash;
+					}
+					sinks[static_cast<size_t>(t)] = sink;
+				}));
+			}
+			for (auto& thread : threads)
+			{
+				thread.join();
+			}
+			auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+			report.Record("resolve_location_cached_4_threads", depth, lookups, static_cast<double>(nanoseconds) / lookups);
+			for (auto sink : sinks)
+			{
+				benchmarkSink += sink;
+			}
+		}
+	}
+
+	// every node of a deep include tree is rebuilt, it requires the already loaded leaves and next node by relative path
+	void IncludeTreeReload(BenchmarkReport& report)
+	{
+		const long long leaves = 32;
+		for (long long depth = 4; depth <= 64; depth *= 4)
+		{
+			ResourceManager manager;
+			BlobFactory blobs;
+			manager.RegisterFactory<Blob>(blobs);
+			IncludeNodeFactory nodes;
+			nodes.depth = depth;
+			for (long long i = 0; i < leaves; i++)
+			{
+				nodes.leafNames.push_back(ResourcePath("leaf" + std::to_string(i) + ".bin"));
+			}
+			manager.RegisterFactory<IncludeNode>(nodes);
+			auto root = manager.Require<IncludeNode>("tree/node.inc");
+			std::vector<ResourcePath> nodePaths;
+			std::string directory = "tree/";
+			for (long long level = 0; level <= depth; level++)
+			{
+				nodePaths.push_back(ResourcePath(directory + "node.inc"));
+				directory += "d/";
+			}
+
+			long long reloads = report.quick ? 100 : 10000;
+			report.Measure("include_tree_reload", depth, reloads, [&](long long i)
+			{
+				manager.NotifyResourceChange(nodePaths[static_cast<size_t>(i % (depth + 1))]);
+			});
+			benchmarkSink += root->leaves.size();
+		}
+	}
+
+	// the same lookups in a map keyed by the path strings and in one keyed by interned paths
+	void InternedPathLookup(BenchmarkReport& report)
+	{
+		long long maximum = report.quick ? 10000 : 1000000;
+		const size_t lookups = report.quick ? 100000 : 1000000;
+		for (long long count = 1000; count <= maximum; count *= 10)
+		{
+			auto paths = MakePaths("interned", count);
+			std::vector<InternedResourcePath> interned;
+			interned.reserve(paths.size());
+			std::unordered_map<ResourcePath, long long, ResourcePath::Hasher> byPath;
+			std::unordered_map<InternedResourcePath, long long, InternedResourcePath::Hasher> byId;
+			for (size_t i = 0; i < paths.size(); i++)
+			{
+				interned.push_back(InternedResourcePath(paths[i]));
+				byPath[paths[i]] = static_cast<long long>(i);
+				byId[interned[i]] = static_cast<long long>(i);
+			}
+			auto indices = MakeShuffledIndices(static_cast<size_t>(count), lookups);
+
+			report.Measure("path_map_find", count, static_cast<long long>(lookups), [&](long long i)
+			{
+				benchmarkSink += byPath.find(paths[indices[static_cast<size_t>(i)]])->second;
+			});
+
+			report.Measure("interned_map_find", count, static_cast<long long>(lookups), [&](long long i)
+			{
+				benchmarkSink += byId.find(interned[indices[static_cast<size_t>(i)]])->second;
+			});
+		}
+	}
+
+	// paths the way they come in from manifests and directory scans
+	std::vector<std::string> MakePathCorpus(const std::string& kind, size_t count)
+	{
+		const char* folders[] = { "Assets", "Textures", "Characters", "Environment", "Props", "Audio", "Materials", "Shaders", "LOD0", "Common" };
+		const char* extensions[] = { ".png", ".DDS", ".mat", ".json", ".fbx", ".wav" };
+		std::mt19937 random(777);
+		std::vector<std::string> corpus;
+		for (size_t i = 0; i < count; i++)
+		{
+			std::string path = kind == "normalized" ? "./" : "";
+			size_t depth = 2 + random() % 6;
+			for (size_t level = 0; level < depth; level++)
+			{
+				path += folders[random() % 10];
+				path += kind == "windows" ? "\\" : "/";
+			}
+			if (kind == "dotted")
+			{
+				path += "../";
+			}
+			path += "File_" + std::to_string(random() % 100000) + extensions[random() % 6];
+			if (kind == "normalized")
+			{
+				for (auto& c : path)
+				{
+					c = static_cast<char>(tolower(c));
+				}
+			}
+			corpus.push_back(path);
+		}
+		return corpus;
+	}
+
+	void NormalizeThroughput(BenchmarkReport& report)
+	{
+		const size_t count = report.quick ? 1000 : 100000;
+		const long long passes = report.quick ? 2 : 20;
+		const char* kinds[] = { "normalized", "manifest", "windows", "dotted" };
+		const char* levelNames[] = { "parser", "scalar", "sse2", "avx2" };
+		auto initial = ResourcePath::GetNormalizeLevel();
+		for (auto kind : kinds)
+		{
+			auto corpus = MakePathCorpus(kind, count);
+			long long bytes = 0;
+			for (auto& path : corpus)
+			{
+				bytes += static_cast<long long>(path.size());
+			}
+			for (int level = 0; level <= static_cast<int>(ResourcePath::GetSupportedNormalizeLevel()); level++)
+			{
+				ResourcePath::SetNormalizeLevel(static_cast<ResourcePath::NormalizeLevel>(level));
+				// the parameter is the average length, ns per iteration is for one path
+				report.Measure(std::string("normalize_") + kind + "_" + levelNames[level], bytes / static_cast<long long>(count), passes * static_cast<long long>(count), [&](long long i)
+				{
+					benchmarkSink += ResourcePath(corpus[static_cast<size_t>(i) % count]).ToCharPtr()[0];
+				});
+			}
+		}
+		ResourcePath::SetNormalizeLevel(initial);
+	}
+
+	// the path operations batch jobs do most, typical paths fit into the inline buffer so none of them allocate
+	void PathOperations(BenchmarkReport& report)
+	{
+		long long iterations = report.quick ? 100000 : 10000000;
+		auto corpus = MakePathCorpus("normalized", 1000);
+		std::vector<ResourcePath> paths(corpus.begin(), corpus.end());
+		ResourcePath sibling("sibling.png");
+
+		report.Measure("path_copy", 1, iterations, [&](long long i)
+		{
+			ResourcePath copy = paths[static_cast<size_t>(i % 1000)];
+			benchmarkSink += copy.Length();
+		});
+
+		report.Measure("path_to_directory", 1, iterations, [&](long long i)
+		{
+			benchmarkSink += paths[static_cast<size_t>(i % 1000)].ToDirectory().Length();
+		});
+
+		report.Measure("path_concatenate", 1, iterations, [&](long long i)
+		{
+			benchmarkSink += (paths[static_cast<size_t>(i % 1000)].ToDirectory() + sibling).Length();
+		});
+	}
+
+	// include and exclude globs over the manifest corpus, like a build input filter
+	std::vector<std::string> MakePatterns(size_t count)
+	{
+		const char* folders[] = { "assets", "textures", "characters", "environment", "props", "audio", "materials", "shaders", "lod0", "common" };
+		const char* extensions[] = { ".png", ".dds", ".mat", ".json", ".fbx", ".wav" };
+		std::vector<std::string> patterns;
+		for (size_t i = 0; i < count; i++)
+		{
+			std::string number = std::to_string(i * 97 % 1000);
+			switch (i % 4)
+			{
+			case 0:
+				patterns.push_back("**/file_" + number + "*" + extensions[i % 6]);
+				break;
+			case 1:
+				patterns.push_back(std::string(folders[i % 10]) + "/*/file_?" + number + extensions[i / 4 % 6]);
+				break;
+			case 2:
+				patterns.push_back(std::string(folders[i % 10]) + "/" + folders[i / 10 % 10] + "/**/*_" + number + ".*");
+				break;
+			default:
+				patterns.push_back(std::string(folders[i / 10 % 10]) + "/" + folders[i % 10] + "/file_" + number + "??.*");
+				break;
+			}
+		}
+		return patterns;
+	}
+
+	void PatternMatching(BenchmarkReport& report)
+	{
+		const long long matches = report.quick ? 10000 : 100000;
+		auto corpus = MakePathCorpus("manifest", 1000);
+		std::vector<ResourcePath> paths(corpus.begin(), corpus.end());
+		for (size_t count = 10; count <= (report.quick ? 100u : 1000u); count *= 10)
+		{
+			auto patterns = MakePatterns(count);
+			std::vector<std::string> include(patterns.begin(), patterns.begin() + count / 2);
+			std::vector<std::string> exclude(patterns.begin() + count / 2, patterns.end());
+			std::vector<ResourcePath> normalizedInclude(include.begin(), include.end());
+			std::vector<ResourcePath> normalizedExclude(exclude.begin(), exclude.end());
+			ResourcePathPattern set(include, exclude);
+
+			// each pattern by itself, stopping at the first include and the first exclude that match
+			report.Measure("pattern_separate_match", static_cast<long long>(count), matches, [&](long long i)
+			{
+				auto& path = paths[static_cast<size_t>(i % 1000)];
+				bool matched = false;
+				for (auto& pattern : normalizedInclude)
+				{
+					if (ResourcePathPattern::MatchGlob(pattern, path))
+					{
+						matched = true;
+						break;
+					}
+				}
+				for (size_t j = 0; matched && j < normalizedExclude.size(); j++)
+				{
+					matched = !ResourcePathPattern::MatchGlob(normalizedExclude[j], path);
+				}
+				benchmarkSink += matched;
+			});
+
+			report.Measure("pattern_set_match", static_cast<long long>(count), matches, [&](long long i)
+			{
+				benchmarkSink += set.Matches(paths[static_cast<size_t>(i % 1000)]);
+			});
+
+			benchmarkSink += static_cast<long long>(set.StateCount());
+		}
+	}
+
+	// search path style lookups, most directories don't have the file so most probes fail
+	void FileSystemLookup(BenchmarkReport& report)
+	{
+		long long lookups = report.quick ? 1000 : 100000;
+		const long long directories = 5;
+		VirtualFileSystem fileSystem;
+		for (long long i = 0; i < directories; i++)
+		{
+			fileSystem.Mount(std::make_shared<DirectoryMount>(ResourcePath("benchmark_search_path_" + std::to_string(i)), ResourcePath("assets")));
+		}
+		auto paths = MakePaths("assets", 1000);
+
+		// every lookup probes every directory on disk
+		report.Measure("file_system_miss_uncached", directories, lookups, [&](long long i)
+		{
+			auto& path = paths[static_cast<size_t>(i % 1000)];
+			fileSystem.Invalidate(path);
+			benchmarkSink += fileSystem.Exists(path);
+		});
+
+		report.Measure("file_system_miss_cached", directories, lookups, [&](long long i)
+		{
+			benchmarkSink += fileSystem.Exists(paths[static_cast<size_t>(i % 1000)]);
+		});
+	}
+}
+
+void RunResourceManagerBenchmarks(BenchmarkReport& report)
+{
+	if (report.IsEnabled("require"))
+	{
+		RequireHitAndMiss(report);
+	}
+	if (report.IsEnabled("nested_require"))
+	{
+		NestedRequire(report);
+	}
+	if (report.IsEnabled("notify_change"))
+	{
+		NotifyChange(report);
+	}
+	if (report.IsEnabled("notify_directory"))
+	{
+		NotifyDirectoryChange(report);
+	}
+	if (report.IsEnabled("resource_ptr"))
+	{
+		PointerOperations(report);
+	}
+	if (report.IsEnabled("inline"))
+	{
+		InlineResources(report);
+	}
+	if (report.IsEnabled("resolve_location"))
+	{
+		ResolveLocation(report);
+	}
+	if (report.IsEnabled("include_tree"))
+	{
+		IncludeTreeReload(report);
+	}
+	if (report.IsEnabled("interned"))
+	{
+		InternedPathLookup(report);
+	}
+	if (report.IsEnabled("normalize"))
+	{
+		NormalizeThroughput(report);
+	}
+	if (report.IsEnabled("path_operations"))
+	{
+		PathOperations(report);
+	}
+	if (report.IsEnabled("path_pattern"))
+	{
+		PatternMatching(report);
+	}
+	if (report.IsEnabled("file_system"))
+	{
+		FileSystemLookup(report);
+	}
+}
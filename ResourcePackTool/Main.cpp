@@ -0,0 +1,63 @@
+#include <Windows.h>
+#include <iostream>
+#include <string>
+#include "ResourcePack.hpp"
+
+// add every file under directory to the pack, paths in the pack are relative to root
+static void AddDirectory(ResourcePackWriter& writer, const std::string& root, const std::string& relative)
+{
+	WIN32_FIND_DATAA found;
+	auto search = FindFirstFileA((root + relative + "*").c_str(), &found);
+	if (search == INVALID_HANDLE_VALUE)
+	{
+		return;
+	}
+	do
+	{
+		std::string name = found.cFileName;
+		if (name == "." || name == "..")
+		{
+			continue;
+		}
+		if (found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+		{
+			AddDirectory(writer, root, relative + name + "/");
+		}
+		else
+		{
+			writer.AddFile(ResourcePath(relative + name), root + relative + name);
+		}
+	} while (FindNextFileA(search, &found));
+	FindClose(search);
+}
+
+// usage: ResourcePackTool <output pack> <input directory> [alignment]
+// packs all files of the directory, paths inside the pack are relative to the input directory
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		std::cerr << "usage: ResourcePackTool <output pack> <input directory> [alignment]\n";
+		return 1;
+	}
+	std::string output = argv[1];
+	std::string root = argv[2];
+	uint32_t alignment = argc > 3 ? static_cast<uint32_t>(std::stoul(argv[3])) : 16;
+	if (root.size() > 0 && root.back() != '/' && root.back() != '\\')
+	{
+		root += '/';
+	}
+	try
+	{
+		ResourcePackWriter writer;
+		AddDirectory(writer, root, "");
+		writer.Write(output, alignment);
+		std::cout << "packed " << writer.Size() << " files into " << output << "\n";
+	}
+	catch (std::exception& error)
+	{
+		std::cerr << "error: " << error.what() << "\n";
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,41 @@
+#include "CppUnitTest.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+#include <string>
+#include <vector>
+#include "../AppServiceSandwich/ContentHash.hpp"
+
+namespace Test
+{
+	TEST_CLASS(ContentHashTest)
+	{
+	public:
+
+		TEST_METHOD(MatchesReferenceValues)
+		{
+			Assert::IsTrue(ContentHash("", 0) == 0xEF46DB3751D8E999ull);
+			Assert::IsTrue(ContentHash("a", 1) == 0xD24EC4F1A98C6E5Bull);
+			Assert::IsTrue(ContentHash("abc", 3) == 0x44BC2CF5AD770999ull);
+			std::string sentence = "Nobody inspects the spammish repetition";
+			Assert::IsTrue(ContentHash(sentence.data(), sentence.size()) == 0xFBCEA83C8A378BF1ull);
+		}
+
+		TEST_METHOD(DetectsSingleByteChange)
+		{
+			std::vector<unsigned char> data(100000);
+			for (size_t i = 0; i < data.size(); i++)
+			{
+				data[i] = static_cast<unsigned char>(i * 7);
+			}
+			auto original = ContentHash(data.data(), data.size());
+			Assert::IsTrue(original == ContentHash(data.data(), data.size()));
+			for (size_t position : { size_t(0), size_t(31), size_t(50000), data.size() - 1 })
+			{
+				data[position] ^= 1;
+				Assert::IsTrue(original != ContentHash(data.data(), data.size()));
+				data[position] ^= 1;
+			}
+		}
+	};
+}
@@ -0,0 +1,80 @@
+#include "CppUnitTest.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "../AppServiceSandwich/InternedResourcePath.hpp"
+
+namespace Test
+{
+	TEST_CLASS(InternedResourcePathTest)
+	{
+	public:
+
+		/*
+		 * TEST CASE: SamePathSameId
+		 *
+		 * spellings which normalize to the same path get the same id, the path and its hash are kept with it
+		 */
+
+		TEST_METHOD(SamePathSameId)
+		{
+			InternedResourcePath a(ResourcePath("Interned/Test/A.txt"));
+			InternedResourcePath b(ResourcePath("./interned\\test/x/../a.txt"));
+			InternedResourcePath c(ResourcePath("interned/test/c.txt"));
+			Assert::IsTrue(a == b);
+			Assert::IsTrue(a != c);
+			Assert::AreEqual(a.Id(), b.Id());
+			Assert::AreEqual(std::string("./interned/test/a.txt"), a.Path().ToString());
+			Assert::AreEqual(ResourcePathMap<int>::Hash(ResourcePath("interned/test/a.txt")), a.Hash());
+
+			// the default path doesn't need the table
+			Assert::AreEqual(0u, InternedResourcePath().Id());
+			Assert::IsTrue(InternedResourcePath() == InternedResourcePath(ResourcePath()));
+
+			std::unordered_map<InternedResourcePath, int, InternedResourcePath::Hasher> map;
+			map[a] = 1;
+			map[c] = 2;
+			Assert::AreEqual(1, map[b]);
+		}
+
+		/*
+		 * TEST CASE: ConcurrentInterning
+		 *
+		 * threads interning the same paths at the same time agree on the ids
+		 */
+
+		TEST_METHOD(ConcurrentInterning)
+		{
+			const int count = 1000;
+			std::vector<std::vector<uint32_t>> ids(4, std::vector<uint32_t>(count));
+			std::vector<std::thread> threads;
+			for (size_t t = 0; t < ids.size(); t++)
+			{
+				threads.push_back(std::thread([&, t]
+				{
+					for (int i = 0; i < count; i++)
+					{
+						ids[t][i] = InternedResourcePath(ResourcePath("concurrent/" + std::to_string(i) + ".txt")).Id();
+					}
+				}));
+			}
+			for (auto& thread : threads)
+			{
+				thread.join();
+			}
+			for (int i = 0; i < count; i++)
+			{
+				for (size_t t = 1; t < ids.size(); t++)
+				{
+					Assert::AreEqual(ids[0][i], ids[t][i]);
+				}
+				InternedResourcePath path(ResourcePath("concurrent/" + std::to_string(i) + ".txt"));
+				Assert::AreEqual(ids[0][i], path.Id());
+				Assert::AreEqual(std::string("./concurrent/") + std::to_string(i) + ".txt", path.Path().ToString());
+			}
+		}
+	};
+}
@@ -3,7 +3,13 @@
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
 #include <map>
+#include <type_traits>
+#include <sstream>
 #include <unordered_map>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <mutex>
 #include "../AppServiceSandwich/ResourceManager.hpp"
 
 namespace Test
@@ -457,5 +463,1482 @@ namespace Test
 			Assert::IsTrue(brick.IsNotNull());
 			Assert::IsTrue(brick.IsLoaded());
 		}
+
+		/*
+		 * TEST CASE: PreloadLoadsAllResources
+		 *
+		 * preload a list of resources on worker threads
+		 * every resource should be built exactly once and later Require calls should reuse them
+		 */
+		class CountingBrickFactory : public ResourceFactory
+		{
+		public:
+			std::atomic<int> calls{ 0 };
+			std::atomic<int> running{ 0 };
+			std::atomic<int> maxRunning{ 0 };
+			unsigned concurrency = 0;
+
+			ManagedResource* operator()(const ResourcePath&, ResourceManagerLocation&) override {
+				calls++;
+				int now = ++running;
+				int seen = maxRunning;
+				while (now > seen && !maxRunning.compare_exchange_weak(seen, now)) {}
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				running--;
+				return new Brick(42);
+			}
+
+			unsigned MaxConcurrency() override
+			{
+				return concurrency;
+			}
+		};
+
+		TEST_METHOD(PreloadLoadsAllResources)
+		{
+			ResourceManager manager;
+			CountingBrickFactory factory;
+			manager.RegisterFactory<Brick>(factory);
+			ResourceList list;
+			for (int i = 0; i < 64; i++)
+			{
+				list.Add<Brick>(ResourcePath("bricks/" + std::to_string(i) + ".txt"));
+			}
+			list.Add<Brick>("bricks/0.txt"); // duplicate
+			manager.Preload(list, 4);
+			Assert::AreEqual(64, factory.calls.load());
+			auto brick = manager.Require<Brick>("bricks/10.txt");
+			Assert::IsTrue(brick->size == 42);
+			Assert::AreEqual(64, factory.calls.load());
+		}
+
+		/*
+		 * TEST CASE: PreloadRespectsConcurrencyLimit
+		 *
+		 * factory declares how many calls it can handle in parallel, preload should never exceed that
+		 */
+		TEST_METHOD(PreloadRespectsConcurrencyLimit)
+		{
+			ResourceManager manager;
+			CountingBrickFactory factory;
+			factory.concurrency = 2;
+			manager.RegisterFactory<Brick>(factory);
+			ResourceList list;
+			for (int i = 0; i < 32; i++)
+			{
+				list.Add<Brick>(ResourcePath(std::to_string(i) + ".txt"));
+			}
+			manager.Preload(list, 8);
+			Assert::AreEqual(32, factory.calls.load());
+			Assert::IsTrue(factory.maxRunning.load() <= 2);
+		}
+
+		/*
+		 * TEST CASE: PreloadWithNestedRequire
+		 *
+		 * factories which require other resources can be preloaded in parallel
+		 */
+		TEST_METHOD(PreloadWithNestedRequire)
+		{
+			ResourceManager manager;
+			manager.RegisterFactory<Wall, WallFactory>();
+			manager.RegisterFactory<Brick, BrickFactory>();
+			ResourceList list;
+			list.Add<Wall>("walls/a.txt").Add<Wall>("walls/b.txt").Add<Brick>("walls/bricks/a.txt");
+			manager.Preload(list, 3);
+			auto wall = manager.Require<Wall>("walls/b.txt");
+			Assert::IsTrue(wall->GetSum() == 2 * 42);
+		}
+
+		/*
+		 * TEST CASE: StatisticsPerType
+		 *
+		 * the manager counts loads, reloads, hits and misses per resource type
+		 */
+		class SizedBrick : public ManagedResource
+		{
+		public:
+			size_t GetMemoryUsage() const override
+			{
+				return 100;
+			}
+		};
+
+		class SizedBrickFactory : public ResourceFactory
+		{
+		public:
+			ManagedResource* operator()(const ResourcePath&, ResourceManagerLocation&) override
+			{
+				return new SizedBrick();
+			}
+		};
+
+		TEST_METHOD(StatisticsPerType)
+		{
+			ResourceManager manager;
+			manager.RegisterFactory<SizedBrick, SizedBrickFactory>();
+			auto a = manager.Require<SizedBrick>("a.txt");
+			auto b = manager.Require<SizedBrick>("b.txt");
+			auto a2 = manager.Require<SizedBrick>("a.txt");
+			b = nullptr;
+			manager.NotifyResourceChange("a.txt");
+
+			auto statistics = manager.GetStatistics();
+			Assert::AreEqual(size_t(1), statistics.size());
+			auto& bricks = statistics[0];
+			Assert::AreEqual(size_t(2), bricks.loaded);
+			Assert::AreEqual(size_t(1), bricks.referenced);
+			Assert::AreEqual(size_t(1), bricks.unreferenced);
+			Assert::AreEqual(size_t(200), bricks.memoryUsage);
+			Assert::AreEqual(2ull, bricks.loads);
+			Assert::AreEqual(1ull, bricks.reloads);
+			Assert::AreEqual(1ull, bricks.hits);
+			Assert::AreEqual(2ull, bricks.misses);
+			unsigned long long histogramTotal = 0;
+			for (auto count : bricks.latencyHistogram) histogramTotal += count;
+			Assert::AreEqual(3ull, histogramTotal);
+
+			auto json = manager.GetStatisticsJson();
+			Assert::IsTrue(json.find("\"reloads\": 1") != std::string::npos);
+		}
+
+		/*
+		 * TEST CASE: GenerationChangesOnReload
+		 *
+		 * a consumer can detect a reload by comparing the generation of the pointer
+		 * and the reload epoch of the manager
+		 */
+		TEST_METHOD(GenerationChangesOnReload)
+		{
+			ResourceManager manager;
+			TestItemLoader loader;
+			manager.RegisterFactory<TestItem>(loader);
+			ResourcePtr<TestItem> empty;
+			Assert::AreEqual(0u, empty.Generation());
+
+			auto item = manager.Require<TestItem>("test.txt");
+			auto other = manager.Require<TestItem>("other.txt");
+			auto generation = item.Generation();
+			auto epoch = manager.GetReloadEpoch();
+			Assert::AreEqual(1u, generation);
+
+			manager.NotifyResourceChange("test.txt");
+			Assert::IsTrue(item.Generation() > generation);
+			Assert::AreEqual(1u, other.Generation());
+			Assert::IsTrue(manager.GetReloadEpoch() > epoch);
+			Assert::IsTrue(item->id == 3);
+		}
+
+		/*
+		 * TEST CASE: ScheduledReloadsAreMerged
+		 *
+		 * repeated change notifications of the same path should result in a single reload
+		 * once the path has been quiet for the configured period
+		 */
+		TEST_METHOD(ScheduledReloadsAreMerged)
+		{
+			ResourceManager manager;
+			TestItemLoader loader;
+			manager.RegisterFactory<TestItem>(loader);
+			auto item = manager.Require<TestItem>("test.txt");
+			manager.SetReloadQuietPeriod(60000);
+			manager.ScheduleResourceChange("test.txt");
+			manager.ScheduleResourceChange("./TEST.txt");
+			manager.ScheduleResourceChange("test.txt");
+			Assert::AreEqual(size_t(0), manager.ProcessScheduledReloads());
+			Assert::IsTrue(item->id == 1);
+			Assert::AreEqual(size_t(1), manager.FlushScheduledReloads());
+			Assert::IsTrue(item->id == 2);
+			Assert::AreEqual(size_t(0), manager.FlushScheduledReloads());
+		}
+
+		/*
+		 * TEST CASE: ScheduledReloadOnBackgroundThread
+		 */
+		TEST_METHOD(ScheduledReloadOnBackgroundThread)
+		{
+			ResourceManager manager;
+			TestItemLoader loader;
+			manager.RegisterFactory<TestItem>(loader);
+			auto item = manager.Require<TestItem>("test.txt");
+			manager.SetReloadQuietPeriod(10);
+			manager.StartReloadThread();
+			for (int i = 0; i < 5; i++)
+			{
+				manager.ScheduleResourceChange("test.txt");
+			}
+			for (int i = 0; i < 200 && item.Generation() == 1; i++)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			}
+			manager.StopReloadThread();
+			Assert::AreEqual(2u, item.Generation());
+			Assert::AreEqual(2, loader.counter);
+		}
+
+		/*
+		 * TEST CASE: ScheduledReloadFailure
+		 *
+		 * a path which fails to reload doesn't stop the other scheduled paths, the failure is rethrown after them
+		 */
+		class FailingItemLoader : public ResourceFactory
+		{
+		public:
+			int counter = 0;
+			bool failBad = false;
+			// factories may throw anything, not only std::exception
+			bool failWithInt = false;
+
+			ManagedResource* operator()(const ResourcePath& path, ResourceManagerLocation&) override
+			{
+				if (failBad && path == ResourcePath("bad.txt"))
+				{
+					if (failWithInt)
+					{
+						throw 42;
+					}
+					throw std::runtime_error("bad");
+				}
+				return new TestItem(++counter);
+			}
+		};
+
+		TEST_METHOD(ScheduledReloadFailure)
+		{
+			ResourceManager manager;
+			FailingItemLoader loader;
+			manager.RegisterFactory<TestItem>(loader);
+			auto bad = manager.Require<TestItem>("bad.txt");
+			auto good = manager.Require<TestItem>("good.txt");
+			auto other = manager.Require<TestItem>("other.txt");
+			loader.failBad = true;
+			manager.ScheduleResourceChange("good.txt");
+			manager.ScheduleResourceChange("bad.txt");
+			manager.ScheduleResourceChange("other.txt");
+			Assert::ExpectException<std::runtime_error>([&] { manager.FlushScheduledReloads(); });
+			Assert::AreEqual(2u, good.Generation());
+			Assert::AreEqual(2u, other.Generation());
+			Assert::AreEqual(1u, bad.Generation());
+			Assert::AreEqual(1, bad->id);
+			Assert::AreEqual(size_t(0), manager.FlushScheduledReloads());
+		}
+
+		/*
+		 * TEST CASE: ScheduledReloadFailureOnBackgroundThread
+		 *
+		 * the reload thread keeps running after a reload throws something which is not a std::exception
+		 */
+		TEST_METHOD(ScheduledReloadFailureOnBackgroundThread)
+		{
+			ResourceManager manager;
+			FailingItemLoader loader;
+			manager.RegisterFactory<TestItem>(loader);
+			auto bad = manager.Require<TestItem>("bad.txt");
+			auto good = manager.Require<TestItem>("good.txt");
+			loader.failBad = true;
+			loader.failWithInt = true;
+			manager.SetReloadQuietPeriod(10);
+			manager.StartReloadThread();
+			manager.ScheduleResourceChange("bad.txt");
+			manager.ScheduleResourceChange("good.txt");
+			WaitFor([&] { return good.Generation() == 2; });
+			manager.ScheduleResourceChange("good.txt");
+			WaitFor([&] { return good.Generation() == 3; });
+			manager.StopReloadThread();
+			Assert::AreEqual(3u, good.Generation());
+			Assert::AreEqual(1u, bad.Generation());
+		}
+
+		/*
+		 * TEST CASE: ProgressiveLoading
+		 *
+		 * the factory publishes a low detail version first, which is usable while the complete version is built
+		 */
+		class StagedBrickFactory : public ResourceFactory
+		{
+		public:
+			std::atomic<bool> finish{ false };
+
+			ManagedResource* operator()(const ResourcePath&, ResourceManagerLocation& location) override
+			{
+				location.PublishPartial(new Brick(1), 1);
+				while (!finish)
+				{
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				}
+				return new Brick(42);
+			}
+		};
+
+		template <typename F> static void WaitFor(F condition)
+		{
+			for (int i = 0; i < 500 && !condition(); i++)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			}
+		}
+
+		TEST_METHOD(ProgressiveLoading)
+		{
+			ResourceManager manager;
+			StagedBrickFactory factory;
+			manager.RegisterFactory<Brick>(factory);
+			auto brick = manager.RequireAsync<Brick>("big.bin");
+			WaitFor([&] { return brick.IsLoaded(); });
+			Assert::IsTrue(brick.IsPartial());
+			Assert::AreEqual(1, brick.Quality());
+			Assert::AreEqual(1, brick->size);
+
+			// other users get the partial version without waiting for the factory
+			auto other = manager.Require<Brick>("big.bin");
+			Assert::AreEqual(1, other->size);
+
+			factory.finish = true;
+			WaitFor([&] { return !brick.IsPartial(); });
+			Assert::IsFalse(brick.IsPartial());
+			Assert::AreEqual(ManagedResourceHolder::CompleteQuality, brick.Quality());
+			Assert::AreEqual(42, brick->size);
+			Assert::AreEqual(2u, brick.Generation());
+		}
+
+		/*
+		 * TEST CASE: RequireAsyncLoadsInBackground
+		 */
+		TEST_METHOD(RequireAsyncLoadsInBackground)
+		{
+			ResourceManager manager;
+			BrickFactory factory;
+			manager.RegisterFactory<Brick>(factory);
+			auto brick = manager.RequireAsync<Brick>("a.txt");
+			Assert::IsTrue(brick.IsNotNull());
+			WaitFor([&] { return brick.IsLoaded(); });
+			Assert::AreEqual(42, brick->size);
+			Assert::IsFalse(brick.IsPartial());
+		}
+
+		/*
+		 * TEST CASE: WeakPointerExpiresAfterCollect
+		 *
+		 * a weak pointer doesn't keep the resource loaded
+		 * after the last strong pointer is gone and the manager collects unreferenced resources it expires
+		 */
+		TEST_METHOD(WeakPointerExpiresAfterCollect)
+		{
+			ResourceManager manager;
+			TestItemLoader loader;
+			manager.RegisterFactory<TestItem>(loader);
+			auto item = manager.Require<TestItem>("item.txt");
+			WeakResourcePtr<TestItem> weak = item;
+			Assert::IsFalse(weak.IsExpired());
+			Assert::AreEqual(1, weak.Lock()->id);
+
+			Assert::AreEqual(size_t(0), manager.CollectUnreferenced());
+			Assert::AreEqual(1, weak.Lock()->id);
+
+			item = nullptr;
+			Assert::AreEqual(size_t(1), manager.CollectUnreferenced());
+			Assert::IsTrue(weak.IsExpired());
+			Assert::IsTrue(weak.Lock().IsNull());
+
+			auto again = manager.Require<TestItem>("item.txt");
+			Assert::AreEqual(2, again->id);
+			Assert::IsTrue(weak.Lock().IsNull());
+		}
+
+		/*
+		 * TEST CASE: ConcurrentRequireAndCollect
+		 *
+		 * Require counts its reference before the container is unlocked,
+		 * so a collect on another thread never unloads a resource which is being returned
+		 */
+		TEST_METHOD(ConcurrentRequireAndCollect)
+		{
+			ResourceManager manager;
+			BrickFactory factory;
+			manager.RegisterFactory<Brick>(factory);
+			std::atomic<bool> done{ false };
+			std::atomic<int> failures{ 0 };
+			std::thread collector([&]
+			{
+				while (!done)
+				{
+					manager.CollectUnreferenced();
+				}
+			});
+			std::vector<std::thread> requirers;
+			for (int t = 0; t < 2; t++)
+			{
+				requirers.push_back(std::thread([&]
+				{
+					for (int i = 0; i < 200000; i++)
+					{
+						auto brick = manager.Require<Brick>("brick.txt");
+						WeakResourcePtr<Brick> weak = brick;
+						if (!brick.IsLoaded() || weak.IsExpired() || brick->size != 42)
+						{
+							failures++;
+						}
+					}
+				}));
+			}
+			for (auto& requirer : requirers)
+			{
+				requirer.join();
+			}
+			done = true;
+			collector.join();
+			Assert::AreEqual(0, failures.load());
+		}
+
+		/*
+		 * TEST CASE: CollectUnreferencedChain
+		 *
+		 * unloading a wall releases its bricks, those are unloaded too
+		 */
+		TEST_METHOD(CollectUnreferencedChain)
+		{
+			ResourceManager manager;
+			manager.RegisterFactory<Wall, WallFactory>();
+			manager.RegisterFactory<Brick, BrickFactory>();
+			WeakResourcePtr<Wall> wall = manager.Require<Wall>("resources/test/wall.txt");
+			Assert::IsFalse(wall.IsExpired());
+			Assert::AreEqual(size_t(3), manager.CollectUnreferenced());
+			Assert::IsTrue(wall.IsExpired());
+			Assert::AreEqual(size_t(0), manager.CollectUnreferenced());
+		}
+
+		/*
+		 * TEST CASE: AsyncLoadsRunInPriorityOrder
+		 *
+		 * while the loader thread is busy, queued loads are ordered by priority
+		 * a queued load can be promoted, cancelled or taken over by a synchronous Require
+		 */
+
+		class OrderedBrickFactory : public ResourceFactory
+		{
+		public:
+			std::atomic<bool> started{ false };
+			std::atomic<bool> release{ false };
+			std::mutex mutex;
+			std::vector<ResourcePath> order;
+
+			ManagedResource* operator()(const ResourcePath& path, ResourceManagerLocation&) override
+			{
+				if (path == ResourcePath("blocker.txt"))
+				{
+					started = true;
+					WaitFor([&] { return release.load(); });
+				}
+				std::lock_guard<std::mutex> guard(mutex);
+				order.push_back(path);
+				return new Brick(static_cast<int>(order.size()));
+			}
+
+			unsigned MaxConcurrency() override { return 0; }
+		};
+
+		TEST_METHOD(AsyncLoadsRunInPriorityOrder)
+		{
+			ResourceManager manager;
+			OrderedBrickFactory factory;
+			manager.RegisterFactory<Brick>(factory);
+			auto blocker = manager.RequireAsync<Brick>("blocker.txt");
+			WaitFor([&] { return factory.started.load(); });
+
+			auto background = manager.RequireAsync<Brick>("background.txt", LoadPriority::Background);
+			auto normal = manager.RequireAsync<Brick>("normal.txt", LoadPriority::Normal);
+			auto interactive = manager.RequireAsync<Brick>("interactive.txt", LoadPriority::Interactive);
+			auto promoted = manager.RequireAsync<Brick>("promoted.txt", LoadPriority::Background);
+			manager.RequireAsync<Brick>("promoted.txt", LoadPriority::Interactive);
+			manager.RequireAsync<Brick>("cancelled.txt", LoadPriority::Background);
+			Assert::IsTrue(manager.CancelLoad<Brick>("cancelled.txt"));
+			Assert::IsFalse(manager.CancelLoad<Brick>("cancelled.txt"));
+			manager.RequireAsync<Brick>("stolen.txt", LoadPriority::Background);
+			auto stolen = manager.Require<Brick>("stolen.txt");
+			Assert::IsTrue(stolen.IsLoaded());
+
+			factory.release = true;
+			WaitFor([&] { return background.IsLoaded(); });
+			Assert::IsTrue(background.IsLoaded());
+			std::vector<ResourcePath> expected = { "stolen.txt", "blocker.txt", "interactive.txt", "promoted.txt", "normal.txt", "background.txt" };
+			std::lock_guard<std::mutex> guard(factory.mutex);
+			Assert::IsTrue(expected == factory.order);
+		}
+
+		/*
+		 * TEST CASE: CancelledLoadIsRequiredAgain
+		 *
+		 * a cancelled resource which is still pointed to is not loaded, until Require or RequireAsync loads it
+		 */
+		TEST_METHOD(CancelledLoadIsRequiredAgain)
+		{
+			ResourceManager manager;
+			OrderedBrickFactory factory;
+			manager.RegisterFactory<Brick>(factory);
+			auto blocker = manager.RequireAsync<Brick>("blocker.txt");
+			WaitFor([&] { return factory.started.load(); });
+
+			auto held = manager.RequireAsync<Brick>("held.txt", LoadPriority::Background);
+			auto queued = manager.RequireAsync<Brick>("queued.txt", LoadPriority::Background);
+			Assert::IsTrue(manager.CancelLoad<Brick>("held.txt"));
+			Assert::IsTrue(manager.CancelLoad<Brick>("queued.txt"));
+			Assert::IsTrue(held.IsNotLoaded());
+
+			// the same holder is loaded, so the pointer kept across the cancel sees it
+			auto required = manager.Require<Brick>("held.txt");
+			Assert::IsTrue(required.IsLoaded());
+			Assert::IsTrue(held.IsLoaded());
+
+			manager.RequireAsync<Brick>("queued.txt");
+			factory.release = true;
+			WaitFor([&] { return queued.IsLoaded(); });
+			Assert::IsTrue(queued.IsLoaded());
+		}
+
+		/*
+		 * TEST CASE: AsyncLoadFailureWithNonStdException
+		 *
+		 * the loader thread keeps loading queued resources after a factory throws something which is not a std::exception
+		 */
+		TEST_METHOD(AsyncLoadFailureWithNonStdException)
+		{
+			ResourceManager manager;
+			FailingItemLoader loader;
+			loader.failBad = true;
+			loader.failWithInt = true;
+			manager.RegisterFactory<TestItem>(loader);
+			auto bad = manager.RequireAsync<TestItem>("bad.txt");
+			auto good = manager.RequireAsync<TestItem>("good.txt");
+			WaitFor([&] { return good.IsLoaded(); });
+			Assert::IsTrue(good.IsLoaded());
+			Assert::IsTrue(bad.IsNotLoaded());
+		}
+
+		/*
+		 * TEST CASE: UnchangedContentSkipsReload
+		 *
+		 * a change notification for a file which has the same contents doesn't call the factory
+		 */
+
+		class FakeContentHashingService : public IContentHashingService
+		{
+		public:
+			unsigned long long hash = 100;
+
+			unsigned long long GetFileContentHash(const ResourcePath&) override
+			{
+				return hash;
+			}
+		};
+
+		TEST_METHOD(UnchangedContentSkipsReload)
+		{
+			ResourceManager manager;
+			FakeContentHashingService hashing;
+			manager.UseContentHashingService(&hashing);
+			TestItemLoader loader;
+			manager.RegisterFactory<TestItem>(loader);
+			auto item = manager.Require<TestItem>("item.txt");
+			Assert::AreEqual(1, item->id);
+
+			manager.NotifyResourceChange("item.txt");
+			Assert::AreEqual(1, item->id);
+			Assert::AreEqual(1, loader.counter);
+
+			hashing.hash = 200;
+			manager.NotifyResourceChange("item.txt");
+			Assert::AreEqual(2, item->id);
+
+			manager.NotifyResourceChange("item.txt");
+			Assert::AreEqual(2, item->id);
+
+			// without information the resource is always reloaded
+			hashing.hash = 0;
+			manager.NotifyResourceChange("item.txt");
+			Assert::AreEqual(3, item->id);
+
+			auto statistics = manager.GetStatistics();
+			Assert::AreEqual(2ull, statistics[0].skippedReloads);
+			Assert::AreEqual(2ull, statistics[0].reloads);
+		}
+
+		/*
+		 * TEST CASE: FactoryReadsFromMountedPack
+		 *
+		 * factories read resource contents through the location, which looks into mounted packs first
+		 */
+
+		class Text : public ManagedResource
+		{
+		public:
+			std::string text;
+
+			explicit Text(const std::string& text) : text(text) { }
+		};
+
+		class TextFactory : public ResourceFactory
+		{
+		public:
+			ManagedResource* operator()(const ResourcePath&, ResourceManagerLocation& location) override
+			{
+				return new Text(location.Read().ToString());
+			}
+		};
+
+		TEST_METHOD(FactoryReadsFromMountedPack)
+		{
+			ResourcePackWriter writer;
+			writer.Add("text/hello.txt", "hello");
+			writer.Add("text/world.txt", "world");
+			std::ostringstream out;
+			writer.Write(out);
+			auto bytes = out.str();
+
+			ResourceManager manager;
+			manager.RegisterFactory<Text, TextFactory>();
+			manager.MountPack(std::make_shared<ResourcePack>(bytes.data(), bytes.size()));
+			Assert::AreEqual(std::string("hello"), manager.Require<Text>("text/hello.txt")->text);
+			Assert::AreEqual(std::string("world"), manager.Require<Text>("text/world.txt")->text);
+			Assert::ExpectException<std::runtime_error>([&] { manager.Require<Text>("text/missing.txt"); });
+		}
+
+		/*
+		 * TEST CASE: MemoryOverlayReloads
+		 *
+		 * a memory overlay mounted above a pack overrides it once the change is notified
+		 */
+
+		TEST_METHOD(MemoryOverlayReloads)
+		{
+			ResourcePackWriter writer;
+			writer.Add("text/hello.txt", "hello");
+			std::ostringstream out;
+			writer.Write(out);
+			auto bytes = out.str();
+
+			ResourceManager manager;
+			manager.RegisterFactory<Text, TextFactory>();
+			manager.MountPack(std::make_shared<ResourcePack>(bytes.data(), bytes.size()));
+			auto overlay = std::make_shared<MemoryMount>();
+			manager.Mount(overlay, 1);
+			auto text = manager.Require<Text>("text/hello.txt");
+			Assert::AreEqual(std::string("hello"), text->text);
+
+			overlay->Write("text/hello.txt", "edited");
+			manager.NotifyResourceChange("text/hello.txt");
+			Assert::AreEqual(std::string("edited"), text->text);
+
+			overlay->Remove("text/hello.txt");
+			manager.NotifyResourceChange("text/hello.txt");
+			Assert::AreEqual(std::string("hello"), text->text);
+		}
+
+		/*
+		 * TEST CASE: RecordAndPrefetchProfile
+		 *
+		 * the order in which resources are first required is recorded
+		 * on the next run the saved profile is loaded in the background in the same order
+		 */
+		TEST_METHOD(RecordAndPrefetchProfile)
+		{
+			std::string saved;
+			{
+				ResourceManager manager;
+				manager.RegisterFactory<Wall, WallFactory>();
+				manager.RegisterFactory<Brick, BrickFactory>();
+				manager.StartProfileRecording();
+				manager.Require<Brick>("first.txt");
+				manager.Require<Wall>("resources/test/wall.txt");
+				manager.Require<Brick>("first.txt");
+				auto profile = manager.StopProfileRecording();
+				manager.Require<Brick>("not/recorded.txt");
+
+				Assert::AreEqual(size_t(4), profile.entries.size());
+				Assert::IsTrue(profile.entries[0].path == ResourcePath("first.txt"));
+				Assert::IsTrue(profile.entries[1].path == ResourcePath("resources/test/wall.txt"));
+				Assert::IsTrue(profile.entries[2].path == ResourcePath("resources/test/bricks/a.txt"));
+				Assert::IsTrue(profile.entries[3].path == ResourcePath("resources/test/bricks/b.txt"));
+				std::ostringstream out;
+				profile.Write(out);
+				saved = out.str();
+			}
+
+			ResourceList profile;
+			std::istringstream in(saved);
+			profile.Read(in);
+			Assert::AreEqual(size_t(4), profile.entries.size());
+			Assert::IsTrue(profile.entries[2].type == typeid(Brick).name());
+
+			ResourceManager manager;
+			OrderedBrickFactory bricks;
+			manager.RegisterFactory<Brick>(bricks);
+			manager.RegisterFactory<Wall, WallFactory>();
+			Assert::AreEqual(size_t(4), manager.PrefetchProfile(profile));
+			Assert::AreEqual(size_t(0), manager.PrefetchProfile(profile));
+			WaitFor([&]
+			{
+				std::lock_guard<std::mutex> guard(bricks.mutex);
+				return bricks.order.size() == 3;
+			});
+			auto wall = manager.Require<Wall>("resources/test/wall.txt");
+			// bricks are numbered in load order
+			Assert::AreEqual(2 + 3, wall->GetSum());
+			std::lock_guard<std::mutex> guard(bricks.mutex);
+			std::vector<ResourcePath> expected = { "first.txt", "resources/test/bricks/a.txt", "resources/test/bricks/b.txt" };
+			Assert::IsTrue(expected == bricks.order);
+		}
+
+		/*
+		 * TEST CASE: HandlesResolveUntilUnloaded
+		 *
+		 * handles are plain data, they resolve to the resource while it's loaded and to null after it's unloaded
+		 */
+		TEST_METHOD(HandlesResolveUntilUnloaded)
+		{
+			static_assert(std::is_trivially_copyable<ResourceHandle<TestItem>>::value, "handles must be plain data");
+			static_assert(sizeof(ResourceHandle<TestItem>) == 8, "handles must be compact");
+
+			ResourceManager manager;
+			TestItemLoader loader;
+			manager.RegisterFactory<TestItem>(loader);
+			ResourceHandle<TestItem> null;
+			Assert::IsTrue(null.IsNull());
+			Assert::IsTrue(manager.Resolve(null) == nullptr);
+
+			auto item = manager.Require<TestItem>("item.txt");
+			auto handle = manager.GetHandle(item);
+			Assert::IsFalse(handle.IsNull());
+			Assert::IsTrue(handle == manager.GetHandle(item));
+			Assert::IsTrue(manager.Resolve(handle) == &*item);
+
+			// the handle follows reloads
+			manager.NotifyResourceChange("item.txt");
+			Assert::AreEqual(2, manager.Resolve(handle)->id);
+
+			auto other = manager.RequireHandle<TestItem>("other.txt");
+			Assert::IsTrue(other != handle);
+			Assert::AreEqual(3, manager.Lock(other)->id);
+
+			item = nullptr;
+			Assert::AreEqual(size_t(2), manager.CollectUnreferenced());
+			Assert::IsTrue(manager.Resolve(handle) == nullptr);
+			Assert::IsTrue(manager.Lock(other).IsNull());
+
+			// slots are reused, but old handles stay invalid
+			auto again = manager.RequireHandle<TestItem>("item.txt");
+			Assert::IsTrue(manager.Resolve(handle) == nullptr);
+			Assert::AreEqual(4, manager.Resolve(again)->id);
+
+			ResourceHandle<TestItem> outOfRange;
+			outOfRange.index = 1000000;
+			outOfRange.generation = 1;
+			Assert::IsTrue(manager.Resolve(outOfRange) == nullptr);
+		}
+
+		/*
+		 * TEST CASE: ReloadInPlaceReusesResource
+		 *
+		 * a factory can update the existing resource on reload instead of building a new one
+		 */
+
+		class Table : public ManagedResource
+		{
+		public:
+			std::vector<int> rows;
+		};
+
+		class TableFactory : public ResourceFactory
+		{
+		public:
+			int version = 0;
+			bool inPlace = true;
+
+			ManagedResource* operator()(const ResourcePath&, ResourceManagerLocation&) override
+			{
+				auto table = new Table();
+				table->rows.assign(1000, ++version);
+				return table;
+			}
+
+			bool ReloadInPlace(const ResourcePath&, ResourceManagerLocation&, ManagedResource& existing) override
+			{
+				if (!inPlace)
+				{
+					return false;
+				}
+				auto& table = dynamic_cast<Table&>(existing);
+				table.rows.assign(table.rows.size(), ++version);
+				return true;
+			}
+		};
+
+		TEST_METHOD(ReloadInPlaceReusesResource)
+		{
+			ResourceManager manager;
+			TableFactory factory;
+			manager.RegisterFactory<Table>(factory);
+			auto table = manager.Require<Table>("table.bin");
+			auto instance = &*table;
+			auto buffer = table->rows.data();
+			Assert::AreEqual(1, table->rows[0]);
+
+			manager.NotifyResourceChange("table.bin");
+			Assert::IsTrue(instance == &*table);
+			Assert::IsTrue(buffer == table->rows.data());
+			Assert::AreEqual(2, table->rows[999]);
+			Assert::AreEqual(2u, table.Generation());
+
+			factory.inPlace = false;
+			manager.NotifyResourceChange("table.bin");
+			Assert::AreEqual(3, table->rows[0]);
+			Assert::AreEqual(3u, table.Generation());
+
+			auto statistics = manager.GetStatistics();
+			Assert::AreEqual(2ull, statistics[0].reloads);
+			Assert::AreEqual(1ull, statistics[0].inPlaceReloads);
+
+			// the holder is free again, so it can be collected
+			table = nullptr;
+			Assert::AreEqual(size_t(1), manager.CollectUnreferenced());
+		}
+
+		/*
+		 * TEST CASE: ResourceSetCommitsTogether
+		 *
+		 * a set is built in the background, all of its resources switch to the new version on commit
+		 * and unloading the set unloads the resources which nothing else points to
+		 */
+
+		class VersionedItemFactory : public ResourceFactory
+		{
+		public:
+			std::atomic<int> version{ 1 };
+
+			ManagedResource* operator()(const ResourcePath& path, ResourceManagerLocation&) override
+			{
+				if (path == ResourcePath("broken.txt"))
+				{
+					throw std::runtime_error("broken");
+				}
+				return new TestItem(version);
+			}
+
+			unsigned MaxConcurrency() override { return 0; }
+		};
+
+		TEST_METHOD(ResourceSetCommitsTogether)
+		{
+			ResourceManager manager;
+			VersionedItemFactory factory;
+			manager.RegisterFactory<TestItem>(factory);
+			ResourceList level;
+			level.Add<TestItem>("level/a.txt").Add<TestItem>("level/b.txt").Add<TestItem>("level/c.txt");
+
+			manager.LoadSet("level", level);
+			manager.CommitSet("level");
+			Assert::IsTrue(manager.IsSetReady("level"));
+			auto a = manager.Require<TestItem>("level/a.txt");
+			auto b = manager.Require<TestItem>("level/b.txt");
+			Assert::AreEqual(1, a->id);
+			Assert::AreEqual(1, b->id);
+			auto epoch = manager.GetReloadEpoch();
+
+			// nothing changes until the commit, then everything changes at once
+			factory.version = 2;
+			manager.LoadSet("level", level);
+			while (!manager.IsSetReady("level"))
+			{
+				std::this_thread::yield();
+			}
+			Assert::AreEqual(1, a->id);
+			Assert::AreEqual(1, b->id);
+			manager.CommitSet("level");
+			Assert::AreEqual(2, a->id);
+			Assert::AreEqual(2, b->id);
+			Assert::AreEqual(2u, a.Generation());
+			Assert::AreEqual(epoch + 1, manager.GetReloadEpoch());
+
+			// a failed build publishes nothing
+			factory.version = 3;
+			ResourceList broken = level;
+			broken.Add<TestItem>("broken.txt");
+			manager.LoadSet("level", broken);
+			Assert::ExpectException<std::runtime_error>([&] { manager.CommitSet("level"); });
+			Assert::AreEqual(2, a->id);
+
+			// a is still pointed to, so it stays loaded
+			b = nullptr;
+			Assert::AreEqual(size_t(2), manager.UnloadSet("level"));
+			Assert::AreEqual(2, a->id);
+			a = nullptr;
+			Assert::AreEqual(size_t(1), manager.CollectUnreferenced());
+			Assert::ExpectException<std::runtime_error>([&] { manager.CommitSet("missing"); });
+		}
+
+		/*
+		 * TEST CASE: ConcurrentLoadSet
+		 *
+		 * loading the same set from several threads waits for the build started by the others
+		 */
+		TEST_METHOD(ConcurrentLoadSet)
+		{
+			ResourceManager manager;
+			VersionedItemFactory factory;
+			manager.RegisterFactory<TestItem>(factory);
+			ResourceList level;
+			level.Add<TestItem>("level/a.txt").Add<TestItem>("level/b.txt");
+			std::vector<std::thread> loaders;
+			for (int t = 0; t < 4; t++)
+			{
+				loaders.push_back(std::thread([&]
+				{
+					for (int i = 0; i < 20; i++)
+					{
+						manager.LoadSet("level", level);
+					}
+				}));
+			}
+			for (auto& loader : loaders)
+			{
+				loader.join();
+			}
+			manager.CommitSet("level");
+			Assert::AreEqual(1, manager.Require<TestItem>("level/a.txt")->id);
+		}
+
+		/*
+		 * TEST CASE: CommitSetClearsLazyChange
+		 *
+		 * a committed version replaces a change marked by the lazy policy, the next access doesn't build it again
+		 */
+		TEST_METHOD(CommitSetClearsLazyChange)
+		{
+			ResourceManager manager;
+			CountingTextFactory factory;
+			manager.RegisterFactory<Text>(factory);
+			manager.SetReloadPolicy(ReloadPolicy::Lazy);
+			auto files = std::make_shared<MemoryMount>();
+			manager.Mount(files, 1);
+			files->Write("level.txt", "v1");
+			auto text = manager.Require<Text>("level.txt");
+
+			files->Write("level.txt", "v2");
+			manager.NotifyResourceChange("level.txt");
+			Assert::IsTrue(text.IsStale());
+			ResourceList level;
+			level.Add<Text>("level.txt");
+			manager.LoadSet("level", level);
+			manager.CommitSet("level");
+			Assert::IsFalse(text.IsStale());
+			auto generation = text.Generation();
+			Assert::AreEqual(std::string("v2"), text->text);
+			Assert::AreEqual(2, factory.builds);
+			Assert::AreEqual(generation, text.Generation());
+		}
+
+		/*
+		 * TEST CASE: SharedCacheBetweenManagers
+		 *
+		 * flat resources built by the writing manager are used by a reader manager without building them again
+		 * the two managers stand in for two processes
+		 */
+
+		class FlatText : public ManagedResource
+		{
+		public:
+			ResourceData data;
+
+			explicit FlatText(ResourceData data) : data(data) { }
+		};
+
+		class FlatTextFactory : public FlatResourceFactory
+		{
+		public:
+			std::string contents = "v1";
+			int builds = 0;
+
+			std::string BuildFlat(const ResourcePath&, ResourceManagerLocation&) override
+			{
+				builds++;
+				return contents;
+			}
+
+			ManagedResource* FromFlat(const ResourcePath&, ResourceData data) override
+			{
+				return new FlatText(data);
+			}
+		};
+
+		TEST_METHOD(SharedCacheBetweenManagers)
+		{
+			auto writerCache = std::make_shared<SharedResourceCache>("AppServiceSandwichTest.SharedCacheBetweenManagers", 1 << 16, 64);
+			ResourceManager writer;
+			FlatTextFactory writerFactory;
+			writer.RegisterFactory<FlatText>(writerFactory);
+			writer.UseSharedCache(writerCache);
+
+			ResourceManager reader;
+			FlatTextFactory readerFactory;
+			reader.RegisterFactory<FlatText>(readerFactory);
+			reader.UseSharedCache(std::make_shared<SharedResourceCache>("AppServiceSandwichTest.SharedCacheBetweenManagers"));
+
+			auto written = writer.Require<FlatText>("config.txt");
+			auto read = reader.Require<FlatText>("config.txt");
+			Assert::AreEqual(std::string("v1"), read->data.ToString());
+			Assert::AreEqual(1, writerFactory.builds);
+			Assert::AreEqual(0, readerFactory.builds);
+			Assert::AreEqual(1ull, reader.GetStatistics()[0].sharedHits);
+
+			// the reader is notified first, the writer didn't store the new version yet so it builds its own
+			writerFactory.contents = readerFactory.contents = "v2";
+			reader.NotifyResourceChange("config.txt");
+			Assert::AreEqual(std::string("v2"), read->data.ToString());
+			Assert::AreEqual(1, readerFactory.builds);
+			reader.NotifyResourceChange("config.txt");
+			Assert::AreEqual(std::string("v2"), read->data.ToString());
+			Assert::AreEqual(2, readerFactory.builds);
+
+			// once the writer stored it, the reader uses the shared version again
+			writerFactory.contents = readerFactory.contents = "v3";
+			writer.NotifyResourceChange("config.txt");
+			Assert::AreEqual(std::string("v3"), written->data.ToString());
+			reader.NotifyResourceChange("config.txt");
+			Assert::AreEqual(std::string("v3"), read->data.ToString());
+			Assert::AreEqual(2, readerFactory.builds);
+			Assert::AreEqual(2ull, reader.GetStatistics()[0].sharedHits);
+
+			// without a cache flat resources are built privately
+			ResourceManager alone;
+			FlatTextFactory aloneFactory;
+			alone.RegisterFactory<FlatText>(aloneFactory);
+			Assert::AreEqual(std::string("v1"), alone.Require<FlatText>("config.txt")->data.ToString());
+		}
+
+		/*
+		 * TEST CASE: InlineResources
+		 *
+		 * small trivially copyable resources are stored by value and reloaded in place by path
+		 */
+
+		struct WindowConfig
+		{
+			int width;
+			float scale;
+		};
+
+		class WindowConfigFactory : public InlineResourceFactory<WindowConfig>
+		{
+		public:
+			int builds = 0;
+
+			WindowConfig Build(const ResourcePath&, ResourceManagerLocation&) override
+			{
+				builds++;
+				return WindowConfig{ 640 * builds, 1.0f * builds };
+			}
+		};
+
+		TEST_METHOD(InlineResources)
+		{
+			ResourceManager manager;
+			Assert::ExpectException<std::runtime_error>([&] { manager.RequireInline<WindowConfig>("window.cfg"); });
+
+			WindowConfigFactory factory;
+			manager.RegisterInlineFactory<WindowConfig>(factory);
+			auto window = manager.RequireInline<WindowConfig>("window.cfg");
+			Assert::IsTrue(window == manager.RequireInline<WindowConfig>("./window.cfg"));
+			Assert::AreEqual(640, window.Get().width);
+			Assert::AreEqual(1u, window.Generation());
+			auto other = manager.RequireInline<WindowConfig>("other.cfg");
+			Assert::IsTrue(window != other);
+			Assert::AreEqual(2, factory.builds);
+
+			auto epoch = manager.GetReloadEpoch();
+			manager.NotifyResourceChange("window.cfg");
+			Assert::AreEqual(1920, window.Get().width);
+			Assert::AreEqual(3.0f, window.Get().scale);
+			Assert::AreEqual(2u, window.Generation());
+			Assert::AreEqual(1u, other.Generation());
+			Assert::AreEqual(epoch + 1, manager.GetReloadEpoch());
+
+			manager.NotifyResourceChange("unrelated.cfg");
+			Assert::AreEqual(3, factory.builds);
+		}
+
+		/*
+		 * TEST CASE: LazyReload
+		 *
+		 * with the lazy policy a change only marks the resource, it's built again when it's used,
+		 * resources which are not referenced are unloaded instead
+		 */
+
+		class CountingTextFactory : public ResourceFactory
+		{
+		public:
+			int builds = 0;
+
+			ManagedResource* operator()(const ResourcePath&, ResourceManagerLocation& location) override
+			{
+				builds++;
+				return new Text(location.Read().ToString());
+			}
+		};
+
+		TEST_METHOD(LazyReload)
+		{
+			ResourceManager manager;
+			CountingTextFactory factory;
+			manager.RegisterFactory<Text>(factory);
+			manager.SetReloadPolicy(ReloadPolicy::Lazy);
+			auto files = std::make_shared<MemoryMount>();
+			manager.Mount(files, 1);
+			files->Write("used.txt", "used v1");
+			files->Write("unused.txt", "unused v1");
+			auto used = manager.Require<Text>("used.txt");
+			manager.Require<Text>("unused.txt");
+			Assert::AreEqual(2, factory.builds);
+
+			files->Write("used.txt", "used v2");
+			files->Write("unused.txt", "unused v2");
+			manager.NotifyResourceChange("used.txt");
+			manager.NotifyResourceChange("unused.txt");
+			manager.NotifyResourceChange("used.txt");
+			Assert::AreEqual(2, factory.builds);
+			Assert::IsTrue(used.IsStale());
+			Assert::AreEqual(0u, (unsigned)manager.CollectUnreferenced());
+
+			auto generation = used.Generation();
+			Assert::AreEqual(std::string("used v2"), used->text);
+			Assert::AreEqual(3, factory.builds);
+			Assert::IsFalse(used.IsStale());
+			Assert::AreEqual(generation + 1, used.Generation());
+			Assert::AreEqual(std::string("used v2"), used->text);
+			Assert::AreEqual(3, factory.builds);
+
+			files->Write("used.txt", "used v3");
+			manager.NotifyResourceChange("used.txt");
+			used.Refresh();
+			Assert::IsFalse(used.IsStale());
+			Assert::AreEqual(4, factory.builds);
+
+			// the unused one was dropped, so requiring it builds the current version
+			Assert::AreEqual(std::string("unused v2"), manager.Require<Text>("unused.txt")->text);
+			Assert::AreEqual(5, factory.builds);
+
+			// a stale resource which becomes unreferenced is collected as usual
+			manager.NotifyResourceChange("used.txt");
+			used = nullptr;
+			Assert::AreEqual(2u, (unsigned)manager.CollectUnreferenced());
+		}
+
+		/*
+		 * TEST CASE: GatedFactoriesRequireEachOther
+		 *
+		 * factories with a concurrency limit of 1 requiring each other's type on two threads,
+		 * a factory gives up its slot while the nested resource is loaded so they don't wait for each other
+		 */
+
+		class CrossBrickFactory : public ResourceFactory
+		{
+		public:
+			std::atomic<int>* entered = nullptr;
+
+			ManagedResource* operator()(const ResourcePath& resourcePath, ResourceManagerLocation& location) override
+			{
+				(*entered)++;
+				WaitFor([&] { return entered->load() >= 2; });
+				if (resourcePath == ResourcePath("a.brick"))
+				{
+					location.Require<Text>("b.txt");
+				}
+				return new Brick(1);
+			}
+		};
+
+		class CrossTextFactory : public ResourceFactory
+		{
+		public:
+			std::atomic<int>* entered = nullptr;
+
+			ManagedResource* operator()(const ResourcePath& resourcePath, ResourceManagerLocation& location) override
+			{
+				(*entered)++;
+				WaitFor([&] { return entered->load() >= 2; });
+				if (resourcePath == ResourcePath("a.txt"))
+				{
+					location.Require<Brick>("b.brick");
+				}
+				return new Text("text");
+			}
+		};
+
+		TEST_METHOD(GatedFactoriesRequireEachOther)
+		{
+			ResourceManager manager;
+			std::atomic<int> entered{ 0 };
+			CrossBrickFactory bricks;
+			CrossTextFactory texts;
+			bricks.entered = &entered;
+			texts.entered = &entered;
+			manager.RegisterFactory<Brick>(bricks);
+			manager.RegisterFactory<Text>(texts);
+
+			std::thread other([&] { manager.Require<Text>("a.txt"); });
+			auto brick = manager.Require<Brick>("a.brick");
+			other.join();
+			Assert::AreEqual(1, brick->size);
+			Assert::IsTrue(manager.Require<Brick>("b.brick").IsLoaded());
+			Assert::IsTrue(manager.Require<Text>("b.txt").IsLoaded());
+		}
+
+		/*
+		 * TEST CASE: ChangeWhileLoading
+		 *
+		 * a change notified while the resource is being loaded builds it again after that load is published,
+		 * the load might have read the file before the change
+		 */
+
+		class GatedTextFactory : public ResourceFactory
+		{
+		public:
+			std::atomic<int> builds{ 0 };
+			std::atomic<bool> release{ false };
+
+			ManagedResource* operator()(const ResourcePath&, ResourceManagerLocation& location) override
+			{
+				auto text = location.Read().ToString();
+				builds++;
+				WaitFor([&] { return release.load(); });
+				return new Text(text);
+			}
+		};
+
+		TEST_METHOD(ChangeWhileLoading)
+		{
+			ResourceManager manager;
+			GatedTextFactory factory;
+			manager.RegisterFactory<Text>(factory);
+			auto files = std::make_shared<MemoryMount>();
+			manager.Mount(files, 1);
+			files->Write("text.txt", "v1");
+			auto text = manager.RequireAsync<Text>("text.txt");
+			WaitFor([&] { return factory.builds.load() == 1; });
+
+			files->Write("text.txt", "v2");
+			manager.NotifyResourceChange("text.txt");
+			factory.release = true;
+			WaitFor([&] { return text.Generation() == 2; });
+			Assert::AreEqual(2u, text.Generation());
+			Assert::AreEqual(std::string("v2"), text->text);
+			Assert::AreEqual(2, factory.builds.load());
+		}
+
+		/*
+		 * TEST CASE: LazyReloadFailure
+		 *
+		 * a lazy rebuild which fails doesn't throw out of the dereference, the previous version is kept
+		 * and the next change builds it again
+		 */
+
+		TEST_METHOD(LazyReloadFailure)
+		{
+			ResourceManager manager;
+			CountingTextFactory factory;
+			manager.RegisterFactory<Text>(factory);
+			manager.SetReloadPolicy(ReloadPolicy::Lazy);
+			auto files = std::make_shared<MemoryMount>();
+			manager.Mount(files, 1);
+			files->Write("text.txt", "v1");
+			auto text = manager.Require<Text>("text.txt");
+
+			files->Remove("text.txt");
+			manager.NotifyResourceChange("text.txt");
+			Assert::IsTrue(text.IsStale());
+			Assert::AreEqual(std::string("v1"), text->text);
+			Assert::IsFalse(text.IsStale());
+			Assert::AreEqual(1u, text.Generation());
+			Assert::AreEqual(1ull, manager.GetStatistics()[0].failedReloads);
+
+			files->Write("text.txt", "v2");
+			manager.NotifyResourceChange("text.txt");
+			Assert::AreEqual(std::string("v2"), text->text);
+			// the failed build was counted too
+			Assert::AreEqual(3, factory.builds);
+		}
+
+		/*
+		 * TEST CASE: DirectoryChange
+		 *
+		 * a directory change reloads everything loaded from under it and nothing else,
+		 * when the directory is gone the remaining paths are still handled before the failure is rethrown
+		 */
+
+		TEST_METHOD(DirectoryChange)
+		{
+			ResourceManager manager;
+			CountingTextFactory factory;
+			manager.RegisterFactory<Text>(factory);
+			WindowConfigFactory inlineFactory;
+			manager.RegisterInlineFactory<WindowConfig>(inlineFactory);
+			auto files = std::make_shared<MemoryMount>();
+			manager.Mount(files, 1);
+			files->Write("levels/one/a.txt", "a v1");
+			files->Write("levels/one/deep/b.txt", "b v1");
+			files->Write("levels/two/c.txt", "c v1");
+			auto a = manager.Require<Text>("levels/one/a.txt");
+			auto b = manager.Require<Text>("levels/one/deep/b.txt");
+			auto c = manager.Require<Text>("levels/two/c.txt");
+			auto window = manager.RequireInline<WindowConfig>("levels/one/window.cfg");
+			Assert::AreEqual(3, factory.builds);
+
+			files->Write("levels/one/a.txt", "a v2");
+			files->Write("levels/one/deep/b.txt", "b v2");
+			manager.NotifyDirectoryChange("levels/one/");
+			Assert::AreEqual(5, factory.builds);
+			Assert::AreEqual(std::string("a v2"), a->text);
+			Assert::AreEqual(std::string("b v2"), b->text);
+			Assert::AreEqual(std::string("c v1"), c->text);
+			Assert::AreEqual(2u, window.Generation());
+
+			// unloaded resources are not reloaded anymore
+			b = nullptr;
+			Assert::AreEqual(1u, (unsigned)manager.CollectUnreferenced());
+			manager.NotifyDirectoryChange("levels/one/deep");
+			Assert::AreEqual(5, factory.builds);
+
+			files->Remove("levels/one/a.txt");
+			files->Remove("levels/two/c.txt");
+			Assert::ExpectException<std::runtime_error>([&] { manager.NotifyDirectoryChange("levels"); });
+			Assert::AreEqual(3u, window.Generation());
+			Assert::AreEqual(std::string("a v2"), a->text);
+		}
+
+		/*
+		 * TEST CASE: ConcurrentReloadAndRead
+		 *
+		 * readers keep using the pointer they got while another thread publishes new versions,
+		 * with RetirePolicy::Manual replaced versions are deleted only by ReleaseRetiredResources
+		 */
+
+		class PartialTextFactory : public ResourceFactory
+		{
+		public:
+			ManagedResource* operator()(const ResourcePath&, ResourceManagerLocation& location) override
+			{
+				location.PublishPartial(new Text("partial"), 1);
+				return new Text("complete");
+			}
+		};
+
+		TEST_METHOD(ConcurrentReloadAndRead)
+		{
+			ResourceManager manager;
+			PartialTextFactory factory;
+			manager.RegisterFactory<Text>(factory);
+			manager.SetRetirePolicy(RetirePolicy::Manual);
+			auto text = manager.Require<Text>("concurrent.txt");
+			const int reloads = 200;
+
+			std::atomic<bool> done{ false };
+			std::atomic<int> mismatches{ 0 };
+			std::vector<std::thread> readers;
+			for (int i = 0; i < 3; i++)
+			{
+				readers.push_back(std::thread([&, text]() mutable
+				{
+					while (!done)
+					{
+						auto resource = text.operator->();
+						std::string value = resource->text;
+						std::this_thread::yield();
+						// still valid after the yield, even if a new version was published meanwhile
+						if ((value != "partial" && value != "complete") || resource->text != value)
+						{
+							mismatches++;
+						}
+					}
+				}));
+			}
+			for (int i = 0; i < reloads; i++)
+			{
+				manager.NotifyResourceChange("concurrent.txt");
+			}
+			done = true;
+			for (auto& reader : readers)
+			{
+				reader.join();
+			}
+			Assert::AreEqual(0, mismatches.load());
+			Assert::AreEqual(std::string("complete"), text->text);
+			// the partial and the complete version of every load except the current one
+			Assert::AreEqual(2u * reloads + 1, (unsigned)manager.ReleaseRetiredResources());
+			Assert::AreEqual(0u, (unsigned)manager.ReleaseRetiredResources());
+		}
+
+		/*
+		 * TEST CASE: ReloadReleasesRetiredVersions
+		 *
+		 * an application which only notifies changes doesn't keep the replaced versions,
+		 * each change deletes the versions replaced by the previous one
+		 */
+
+		class LiveText : public ManagedResource
+		{
+		public:
+			std::atomic<int>& live;
+
+			explicit LiveText(std::atomic<int>& live) : live(live) { live++; }
+
+			~LiveText() { live--; }
+		};
+
+		class LiveTextFactory : public ResourceFactory
+		{
+		public:
+			std::atomic<int> live{ 0 };
+
+			ManagedResource* operator()(const ResourcePath&, ResourceManagerLocation&) override
+			{
+				return new LiveText(live);
+			}
+		};
+
+		TEST_METHOD(ReloadReleasesRetiredVersions)
+		{
+			LiveTextFactory factory;
+			{
+				ResourceManager manager;
+				manager.RegisterFactory<LiveText>(factory);
+				auto text = manager.Require<LiveText>("live.txt");
+				for (int i = 0; i < 100; i++)
+				{
+					manager.NotifyResourceChange("live.txt");
+					// the current version and the one it replaced
+					Assert::IsTrue(factory.live.load() <= 2);
+				}
+				Assert::AreEqual(101u, text.Generation());
+				manager.CollectUnreferenced();
+				Assert::AreEqual(1, factory.live.load());
+			}
+			Assert::AreEqual(0, factory.live.load());
+		}
+
+		/*
+		 * TEST CASE: RequireInternedPath
+		 *
+		 * an interned path finds the same resource as the path it was made from
+		 */
+
+		TEST_METHOD(RequireInternedPath)
+		{
+			ResourceManager manager;
+			TestItemLoader loader;
+			manager.RegisterFactory<TestItem>(loader);
+			auto item = manager.Require<TestItem>("items/interned.txt");
+			InternedResourcePath path(ResourcePath("Items/Interned.txt"));
+			Assert::AreEqual(1, manager.Require<TestItem>(path)->id);
+			Assert::AreEqual(2, manager.Require<TestItem>(InternedResourcePath(ResourcePath("items/other.txt")))->id);
+			Assert::AreEqual(2, manager.Require<TestItem>("items/other.txt")->id);
+		}
 	};
 }
\ No newline at end of file
@@ -0,0 +1,66 @@
+#include "CppUnitTest.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+#include <sstream>
+#include <string>
+#include "../AppServiceSandwich/ResourcePack.hpp"
+
+namespace Test
+{
+	TEST_CLASS(ResourcePackTest)
+	{
+	public:
+
+		static std::string WritePack(const ResourcePackWriter& writer)
+		{
+			std::ostringstream out;
+			writer.Write(out);
+			return out.str();
+		}
+
+		TEST_METHOD(WriteAndFind)
+		{
+			ResourcePackWriter writer;
+			writer.Add("textures/stone.txt", "stone");
+			writer.Add("Textures\\Grass.txt", "grass");
+			writer.Add("empty.txt", "");
+			for (int i = 0; i < 1000; i++)
+			{
+				writer.Add(ResourcePath("many/" + std::to_string(i) + ".txt"), std::to_string(i * i));
+			}
+			auto bytes = WritePack(writer);
+			ResourcePack pack(bytes.data(), bytes.size());
+			Assert::AreEqual(size_t(1003), pack.Size());
+
+			const char* data;
+			size_t size;
+			Assert::IsTrue(pack.Find("textures/grass.txt", data, size));
+			Assert::AreEqual(std::string("grass"), std::string(data, size));
+			// blobs are aligned so that they can be used in place
+			Assert::IsTrue((data - bytes.data()) % 16 == 0);
+			Assert::IsTrue(pack.Find("./textures/../textures/stone.txt", data, size));
+			Assert::AreEqual(std::string("stone"), std::string(data, size));
+			Assert::IsTrue(pack.Find("empty.txt", data, size));
+			Assert::AreEqual(size_t(0), size);
+			Assert::IsTrue(pack.Find("many/999.txt", data, size));
+			Assert::AreEqual(std::string("998001"), std::string(data, size));
+			Assert::IsFalse(pack.Find("many/1000.txt", data, size));
+		}
+
+		TEST_METHOD(RejectsInvalidData)
+		{
+			std::string garbage(64, 'x');
+			Assert::ExpectException<std::runtime_error>([&] { ResourcePack pack(garbage.data(), garbage.size()); });
+
+			ResourcePackWriter writer;
+			writer.Add("a.txt", "hello");
+			auto bytes = WritePack(writer);
+			auto truncated = bytes.substr(0, bytes.size() - 2);
+			Assert::ExpectException<std::runtime_error>([&] { ResourcePack pack(truncated.data(), truncated.size()); });
+
+			writer.Add("A.txt", "twice");
+			Assert::ExpectException<std::runtime_error>([&] { WritePack(writer); });
+		}
+	};
+}
@@ -0,0 +1,70 @@
+#include "CppUnitTest.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+#include <string>
+#include <vector>
+#include "../AppServiceSandwich/ResourcePathMap.hpp"
+
+namespace Test
+{
+	TEST_CLASS(ResourcePathMapTest)
+	{
+	public:
+
+		TEST_METHOD(InsertAndFind)
+		{
+			ResourcePathMap<int> map;
+			auto inserted = map.Insert("a/a.txt");
+			Assert::IsTrue(inserted.second);
+			inserted.first->value = 1;
+			map.Insert("a/b.txt").first->value = 2;
+			Assert::AreEqual(1, map.Find("a/a.txt")->value);
+			Assert::AreEqual(2, map.Find("A\\B.txt")->value);
+			Assert::IsTrue(map.Find("a/c.txt") == nullptr);
+			Assert::IsFalse(map.Insert("a/a.txt").second);
+			Assert::AreEqual(size_t(2), map.Size());
+		}
+
+		TEST_METHOD(AddressIsStable)
+		{
+			ResourcePathMap<int> map;
+			auto first = map.Insert("first.txt").first;
+			for (int i = 0; i < 10000; i++)
+			{
+				map.Insert(ResourcePath("items/" + std::to_string(i) + ".bin")).first->value = i;
+			}
+			Assert::IsTrue(first == map.Find("first.txt"));
+			for (int i = 0; i < 10000; i++)
+			{
+				Assert::AreEqual(i, map.Find(ResourcePath("items/" + std::to_string(i) + ".bin"))->value);
+			}
+		}
+
+		TEST_METHOD(EraseAndReuse)
+		{
+			ResourcePathMap<std::string> map;
+			for (int i = 0; i < 100; i++)
+			{
+				map.Insert(ResourcePath(std::to_string(i) + ".txt")).first->value = std::to_string(i);
+			}
+			for (int i = 0; i < 100; i += 2)
+			{
+				Assert::IsTrue(map.Erase(ResourcePath(std::to_string(i) + ".txt")));
+			}
+			Assert::AreEqual(size_t(50), map.Size());
+			Assert::IsTrue(map.Find("0.txt") == nullptr);
+			Assert::AreEqual(std::string("1"), map.Find("1.txt")->value);
+			map.Insert("0.txt").first->value = "again";
+			Assert::AreEqual(std::string("again"), map.Find("0.txt")->value);
+
+			size_t visited = 0;
+			for (auto& entry : map)
+			{
+				Assert::IsTrue(map.Find(entry.key) == &entry);
+				visited++;
+			}
+			Assert::AreEqual(size_t(51), visited);
+		}
+	};
+}
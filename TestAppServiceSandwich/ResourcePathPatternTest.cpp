@@ -0,0 +1,186 @@
+#include "CppUnitTest.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../AppServiceSandwich/ResourcePathPattern.hpp"
+
+namespace Test
+{
+	TEST_CLASS(ResourcePathPatternTest)
+	{
+	public:
+
+		/*
+		 * TEST CASE: Wildcards
+		 *
+		 * * and ? stay within a segment, ** as a whole segment matches any number of segments
+		 */
+
+		TEST_METHOD(Wildcards)
+		{
+			ResourcePathPattern json({ "**/*.json" });
+			Assert::IsTrue(json.Matches("a.json"));
+			Assert::IsTrue(json.Matches("config/deep/A.JSON"));
+			Assert::IsFalse(json.Matches("config/a.json.bak"));
+			Assert::IsFalse(json.Matches("/config/a.json"));
+
+			ResourcePathPattern lod({ "assets/*/lod?.bin" });
+			Assert::IsTrue(lod.Matches("assets/tree/lod0.bin"));
+			Assert::IsTrue(lod.Matches("assets\\rock\\LOD1.bin"));
+			Assert::IsFalse(lod.Matches("assets/tree/lod10.bin"));
+			Assert::IsFalse(lod.Matches("assets/tree/big/lod0.bin"));
+			Assert::IsFalse(lod.Matches("assets/lod0.bin"));
+
+			ResourcePathPattern under({ "levels/**/map.bin", "sounds/**" });
+			Assert::IsTrue(under.Matches("levels/map.bin"));
+			Assert::IsTrue(under.Matches("levels/one/two/map.bin"));
+			Assert::IsFalse(under.Matches("levels/one/two/minimap.bin"));
+			Assert::IsTrue(under.Matches("sounds/"));
+			Assert::IsTrue(under.Matches("sounds/music/theme.ogg"));
+			Assert::IsFalse(under.Matches("sounds"));
+
+			// not a whole segment, so it's the same as *
+			ResourcePathPattern star({ "a**.txt" });
+			Assert::IsTrue(star.Matches("abc.txt"));
+			Assert::IsFalse(star.Matches("a/b.txt"));
+		}
+
+		/*
+		 * TEST CASE: IncludeAndExclude
+		 *
+		 * a path matches if some include matches and no exclude does, without includes everything is included
+		 */
+
+		TEST_METHOD(IncludeAndExclude)
+		{
+			ResourcePathPattern set({ "**/*.json", "**/*.png" }, { "build/**", "**/*.tmp.*" });
+			Assert::IsTrue(set.Matches("ui/icon.png"));
+			Assert::IsTrue(set.Matches("config.json"));
+			Assert::IsFalse(set.Matches("build/config.json"));
+			Assert::IsFalse(set.Matches("ui/icon.tmp.png"));
+			Assert::IsFalse(set.Matches("ui/icon.bmp"));
+
+			ResourcePathPattern excludeOnly({}, { "*.bak" });
+			Assert::IsTrue(excludeOnly.Matches("a.txt"));
+			Assert::IsTrue(excludeOnly.Matches("dir/a.bak"));
+			Assert::IsFalse(excludeOnly.Matches("a.bak"));
+
+			ResourcePathPattern empty({});
+			Assert::IsTrue(empty.Matches("anything/at/all"));
+			Assert::AreEqual(1u, (unsigned)empty.StateCount());
+		}
+
+		/*
+		 * TEST CASE: SameAsSeparateMatches
+		 *
+		 * random patterns and paths, the compiled set gives the same answer as matching each pattern by itself
+		 */
+
+		TEST_METHOD(SameAsSeparateMatches)
+		{
+			std::mt19937 random(42);
+			const char* patternParts[] = { "a", "b", "ab", "*", "?", "**", "*a", "b?", ".x" };
+			const char* pathParts[] = { "a", "b", "ab", "ba", "aab", "a.x", "bb.x", "x" };
+			auto pick = [&](size_t count) { return static_cast<size_t>(random() % count); };
+			for (int round = 0; round < 200; round++)
+			{
+				std::vector<std::string> include, exclude;
+				size_t patternCount = 1 + pick(6);
+				for (size_t i = 0; i < patternCount; i++)
+				{
+					std::string pattern;
+					size_t segments = 1 + pick(4);
+					for (size_t j = 0; j < segments; j++)
+					{
+						pattern += j == 0 ? "" : "/";
+						pattern += patternParts[pick(9)];
+						pattern += pick(3) == 0 ? patternParts[pick(9)] : "";
+					}
+					(i % 3 == 2 ? exclude : include).push_back(pattern);
+				}
+				ResourcePathPattern set(include, exclude);
+				// after the few states it may build the rest of each path follows the NFA
+				ResourcePathPattern small(include, exclude, 3);
+				for (int i = 0; i < 50; i++)
+				{
+					std::string text;
+					size_t segments = 1 + pick(5);
+					for (size_t j = 0; j < segments; j++)
+					{
+						text += j == 0 ? "" : "/";
+						text += pathParts[pick(8)];
+					}
+					ResourcePath path(text);
+					bool included = include.empty();
+					bool excluded = false;
+					for (auto& pattern : include)
+					{
+						included = included || ResourcePathPattern::MatchGlob(pattern, path);
+					}
+					for (auto& pattern : exclude)
+					{
+						excluded = excluded || ResourcePathPattern::MatchGlob(pattern, path);
+					}
+					Assert::AreEqual(included && !excluded, set.Matches(path));
+					Assert::AreEqual(included && !excluded, small.Matches(path));
+				}
+				Assert::IsTrue(small.StateCount() <= 3);
+			}
+		}
+
+		/*
+		 * TEST CASE: ConcurrentMatching
+		 *
+		 * threads which reach the same states for the first time at once build each of them once
+		 * and agree on every answer
+		 */
+
+		TEST_METHOD(ConcurrentMatching)
+		{
+			std::vector<std::string> include, exclude;
+			for (int i = 0; i < 50; i++)
+			{
+				include.push_back("**/item_" + std::to_string(i) + "*.bin");
+				exclude.push_back("dir_" + std::to_string(i % 7) + "/**/*_" + std::to_string(i) + "?.bin");
+			}
+			std::vector<ResourcePath> paths;
+			for (int i = 0; i < 2000; i++)
+			{
+				paths.push_back("dir_" + std::to_string(i % 11) + "/sub_" + std::to_string(i % 5) + "/item_" + std::to_string(i % 97) + ".bin");
+			}
+			ResourcePathPattern reference(include, exclude);
+			std::vector<bool> expected;
+			for (auto& path : paths)
+			{
+				expected.push_back(reference.Matches(path));
+			}
+
+			ResourcePathPattern set(include, exclude);
+			std::vector<int> mismatches(4, 0);
+			std::vector<std::thread> threads;
+			for (size_t t = 0; t < mismatches.size(); t++)
+			{
+				threads.push_back(std::thread([&, t]
+				{
+					for (size_t i = 0; i < paths.size(); i++)
+					{
+						mismatches[t] += set.Matches(paths[(i * 7 + t * 500) % paths.size()]) != expected[(i * 7 + t * 500) % paths.size()];
+					}
+				}));
+			}
+			for (auto& thread : threads)
+			{
+				thread.join();
+			}
+			for (auto count : mismatches)
+			{
+				Assert::AreEqual(0, count);
+			}
+			Assert::AreEqual(reference.StateCount(), set.StateCount());
+		}
+	};
+}
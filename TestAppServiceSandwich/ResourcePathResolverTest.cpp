@@ -0,0 +1,143 @@
+#include "CppUnitTest.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "../AppServiceSandwich/ResourcePathResolver.hpp"
+#include "../AppServiceSandwich/ResourcePathMap.hpp"
+
+namespace Test
+{
+	TEST_CLASS(ResourcePathResolverTest)
+	{
+	public:
+
+		/*
+		 * TEST CASE: SameAsResolveLocation
+		 *
+		 * cached results are the same paths that resolving them directly gives
+		 */
+
+		TEST_METHOD(SameAsResolveLocation)
+		{
+			ResourcePathResolver resolver;
+			unsigned long long firstPassHits = 0;
+			const char* current[] = { "materials/stone.mat", "materials/", "materials/rock/stone.mat", "/abs/file.txt", "top.mat" };
+			const char* relative[] = { "stone.png", "../textures/stone.png", "sub/detail.png", "/absolute/stone.png", "c:/drive/stone.png" };
+			for (int pass = 0; pass < 2; pass++)
+			{
+				firstPassHits = pass == 1 ? resolver.GetStatistics().hits : 0;
+				for (auto c : current)
+				{
+					for (auto r : relative)
+					{
+						auto expected = ResourcePathResolver::ResolveLocation(c, r);
+						auto resolved = resolver.Resolve(c, r);
+						Assert::AreEqual(expected.ToString(), resolved.path.ToString());
+						Assert::AreEqual(ResourcePathMap<int>::Hash(expected), resolved.hash);
+					}
+				}
+			}
+			// the second pass found everything
+			auto statistics = resolver.GetStatistics();
+			Assert::AreEqual(50ull, statistics.lookups);
+			Assert::AreEqual(firstPassHits + 25, statistics.hits);
+		}
+
+		/*
+		 * TEST CASE: SiblingsShareDirectory
+		 *
+		 * only the directory of the current location matters, so files in the same directory share results
+		 * and absolute paths are cached once no matter where they are required from
+		 */
+
+		TEST_METHOD(SiblingsShareDirectory)
+		{
+			ResourcePathResolver resolver;
+			resolver.Resolve("materials/stone.mat", "stone.png");
+			Assert::AreEqual(std::string("./materials/stone.png"), resolver.Resolve("materials/brick.mat", "stone.png").path.ToString());
+			Assert::AreEqual(1ull, resolver.GetStatistics().hits);
+			Assert::AreEqual(std::string("./other/stone.png"), resolver.Resolve("other/stone.mat", "stone.png").path.ToString());
+			Assert::AreEqual(1ull, resolver.GetStatistics().hits);
+			resolver.Resolve("materials/stone.mat", "/shared/noise.png");
+			resolver.Resolve("other/stone.mat", "/shared/noise.png");
+			Assert::AreEqual(2ull, resolver.GetStatistics().hits);
+			Assert::AreEqual(size_t(3), resolver.Size());
+		}
+
+		/*
+		 * TEST CASE: ClockEviction
+		 *
+		 * a full cache replaces the first entry the clock hand finds unused since its last pass,
+		 * entries which were used again are kept for another round
+		 */
+
+		TEST_METHOD(ClockEviction)
+		{
+			ResourcePathResolver resolver(3, 1);
+			resolver.Resolve("a/x.mat", "a.png");
+			resolver.Resolve("a/x.mat", "b.png");
+			resolver.Resolve("a/x.mat", "c.png");
+			resolver.Resolve("a/x.mat", "a.png");
+			Assert::AreEqual(1ull, resolver.GetStatistics().hits);
+
+			// a was used, so b is replaced
+			resolver.Resolve("a/x.mat", "d.png");
+			Assert::AreEqual(size_t(3), resolver.Size());
+			Assert::AreEqual(1ull, resolver.GetStatistics().evictions);
+			resolver.Resolve("a/x.mat", "a.png");
+			resolver.Resolve("a/x.mat", "d.png");
+			Assert::AreEqual(3ull, resolver.GetStatistics().hits);
+
+			// b is resolved again and replaces c, the next one after the hand
+			auto b = resolver.Resolve("a/x.mat", "b.png");
+			Assert::AreEqual(std::string("./a/b.png"), b.path.ToString());
+			Assert::AreEqual(3ull, resolver.GetStatistics().hits);
+			resolver.Resolve("a/x.mat", "b.png");
+			resolver.Resolve("a/x.mat", "a.png");
+			resolver.Resolve("a/x.mat", "d.png");
+			Assert::AreEqual(6ull, resolver.GetStatistics().hits);
+			resolver.Resolve("a/x.mat", "c.png");
+			Assert::AreEqual(6ull, resolver.GetStatistics().hits);
+		}
+
+		/*
+		 * TEST CASE: ConcurrentResolve
+		 *
+		 * threads resolving overlapping pairs in a cache too small for all of them always get the right path
+		 */
+
+		TEST_METHOD(ConcurrentResolve)
+		{
+			ResourcePathResolver resolver(64, 4);
+			std::atomic<int> mismatches{ 0 };
+			std::vector<std::thread> threads;
+			for (int t = 0; t < 4; t++)
+			{
+				threads.push_back(std::thread([&, t]
+				{
+					for (int i = 0; i < 20000; i++)
+					{
+						int n = (i * 7 + t) % 200;
+						ResourcePath current("dir" + std::to_string(n % 10) + "/file.mat");
+						ResourcePath relative("../tex" + std::to_string(n) + ".png");
+						auto resolved = resolver.Resolve(current, relative);
+						if (resolved.path != ResourcePathResolver::ResolveLocation(current, relative) || resolved.hash != ResourcePathMap<int>::Hash(resolved.path))
+						{
+							mismatches++;
+						}
+					}
+				}));
+			}
+			for (auto& thread : threads)
+			{
+				thread.join();
+			}
+			Assert::AreEqual(0, mismatches.load());
+			Assert::IsTrue(resolver.Size() <= 64);
+			Assert::IsTrue(resolver.GetStatistics().evictions > 0);
+		}
+	};
+}
@@ -3,7 +3,9 @@
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
 #include <map>
+#include <random>
 #include <unordered_map>
+#include <vector>
 #include "../AppServiceSandwich/ResourcePath.hpp"
 
 namespace Test
@@ -95,5 +97,88 @@ namespace Test
 		}
 
 
+
+		/*
+		 * TEST CASE: FastNormalizeMatchesParser
+		 *
+		 * every fast path level gives the same result as the parser, also for the paths where it gives up
+		 */
+
+		TEST_METHOD(FastNormalizeMatchesParser)
+		{
+			const char alphabet[] = "aZ./\\:c";
+			std::mt19937 random(42);
+			std::vector<std::string> inputs = { "", ".", "..", "./", "/", "c:/", "C:\\Dir\\", "a./b", "./.hidden", "c:a", "./../x",
+				std::string(100, 'A') + "/./" + std::string(40, 'b'), std::string(63, 'x') + "//y" };
+			for (int i = 0; i < 20000; i++)
+			{
+				std::string input;
+				size_t length = random() % 80;
+				for (size_t j = 0; j < length; j++)
+				{
+					input += alphabet[random() % (sizeof(alphabet) - 1)];
+				}
+				inputs.push_back(input);
+			}
+
+			auto normalize = [](const std::string& input)
+			{
+				try
+				{
+					return ResourcePath(input).ToString();
+				}
+				catch (ResourcePath::Exception&)
+				{
+					return std::string("exception");
+				}
+			};
+			auto initial = ResourcePath::GetNormalizeLevel();
+			ResourcePath::SetNormalizeLevel(ResourcePath::NormalizeLevel::Parser);
+			std::vector<std::string> expected;
+			for (auto& input : inputs)
+			{
+				expected.push_back(normalize(input));
+			}
+			ResourcePath::NormalizeLevel levels[] = { ResourcePath::NormalizeLevel::Scalar, ResourcePath::NormalizeLevel::Sse2, ResourcePath::NormalizeLevel::Avx2 };
+			for (auto level : levels)
+			{
+				ResourcePath::SetNormalizeLevel(level);
+				for (size_t i = 0; i < inputs.size(); i++)
+				{
+					Assert::AreEqual(expected[i], normalize(inputs[i]));
+				}
+			}
+			ResourcePath::SetNormalizeLevel(initial);
+			Assert::AreEqual(std::string("./a/b/c"), (ResourcePath("a/") + ResourcePath("b/") + ResourcePath("c")).ToString());
+		}
+
+		/*
+		 * TEST CASE: InlineStorage
+		 *
+		 * typical paths stay in the inline buffer through normalization, ToDirectory and concatenation,
+		 * longer ones are allocated and behave the same
+		 */
+
+		TEST_METHOD(InlineStorage)
+		{
+			ResourcePath path("Assets\\Textures\\Stone.png");
+			Assert::IsTrue(path.IsInline());
+			Assert::IsTrue(path.ToDirectory().IsInline());
+			auto combined = path.ToDirectory() + ResourcePath("../materials/stone.mat");
+			Assert::IsTrue(combined.IsInline());
+			Assert::AreEqual(std::string("./assets/materials/stone.mat"), combined.ToString());
+
+			std::string longName(300, 'x');
+			ResourcePath longPath("assets/" + longName + ".png");
+			Assert::IsFalse(longPath.IsInline());
+			Assert::AreEqual(std::string("./assets/") + longName + ".png", longPath.ToString());
+			Assert::IsTrue(longPath.ToDirectory() == ResourcePath("assets/"));
+			ResourcePath copy = longPath;
+			Assert::IsTrue(copy == longPath);
+			ResourcePath moved = std::move(copy);
+			Assert::IsTrue(moved == longPath);
+			Assert::IsTrue(ResourcePath("assets/") + ResourcePath(longName + ".png") == longPath);
+			Assert::IsTrue(ResourcePath("a.png") < longPath);
+		}
 	};
 }
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "CppUnitTest.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "../AppServiceSandwich/ResourcePathTrie.hpp"
+
+namespace Test
+{
+	TEST_CLASS(ResourcePathTrieTest)
+	{
+	public:
+
+		/*
+		 * TEST CASE: InsertFindErase
+		 *
+		 * the trie works as a map from paths, a directory with or without the trailing separator is the same key
+		 */
+
+		TEST_METHOD(InsertFindErase)
+		{
+			ResourcePathTrie<int> trie;
+			auto inserted = trie.Insert("Levels/One/map.bin");
+			Assert::IsTrue(inserted.second);
+			inserted.first->value = 1;
+			Assert::IsFalse(trie.Insert("levels/one/map.bin").second);
+			Assert::AreEqual(std::string("./levels/one/map.bin"), trie.Find("levels/one/map.bin")->key.ToString());
+			Assert::IsNull(trie.Find("levels/one"));
+			Assert::IsNull(trie.Find("levels/one/map"));
+
+			trie.Insert("levels/one/").first->value = 2;
+			Assert::AreEqual(2, trie.Find("levels/one")->value);
+			Assert::AreEqual(2u, (unsigned)trie.Size());
+
+			Assert::IsTrue(trie.Erase("levels/one/map.bin"));
+			Assert::IsFalse(trie.Erase("levels/one/map.bin"));
+			Assert::IsNull(trie.Find("levels/one/map.bin"));
+			Assert::AreEqual(2, trie.Find("levels/one/")->value);
+			Assert::AreEqual(1u, (unsigned)trie.Size());
+
+			// absolute and relative paths don't share nodes
+			trie.Insert("/levels/one");
+			Assert::AreEqual(2u, (unsigned)trie.Size());
+			trie.Clear();
+			Assert::AreEqual(0u, (unsigned)trie.Size());
+			Assert::IsNull(trie.Find("levels/one"));
+		}
+
+		/*
+		 * TEST CASE: Directories
+		 *
+		 * entries under a directory are visited and erased together, the longest prefix is the nearest
+		 * directory above a path which has an entry
+		 */
+
+		TEST_METHOD(Directories)
+		{
+			ResourcePathTrie<int> trie;
+			const char* paths[] = { "levels/one/map.bin", "levels/one/sky/day.png", "levels/two/map.bin", "levels/one.txt", "levels" };
+			for (auto path : paths)
+			{
+				trie.Insert(path);
+			}
+
+			std::vector<std::string> under;
+			trie.ForEachUnder("levels/one/", [&](ResourcePathTrie<int>::Entry& entry) { under.push_back(entry.key.ToString()); });
+			std::sort(under.begin(), under.end());
+			Assert::AreEqual(2u, (unsigned)under.size());
+			Assert::AreEqual(std::string("./levels/one/map.bin"), under[0]);
+			Assert::AreEqual(std::string("./levels/one/sky/day.png"), under[1]);
+
+			auto prefix = trie.FindLongestPrefix("levels/one/sky/night.png");
+			Assert::AreEqual(std::string("./levels"), prefix->key.ToString());
+			trie.Insert("levels/one/sky");
+			Assert::AreEqual(std::string("./levels/one/sky"), trie.FindLongestPrefix("levels/one/sky/night.png")->key.ToString());
+			Assert::AreEqual(std::string("./levels/two/map.bin"), trie.FindLongestPrefix("levels/two/map.bin")->key.ToString());
+			Assert::IsNull(trie.FindLongestPrefix("models/box.bin"));
+
+			Assert::AreEqual(3u, (unsigned)trie.EraseUnder("levels/one"));
+			Assert::AreEqual(0u, (unsigned)trie.EraseUnder("levels/one"));
+			Assert::AreEqual(3u, (unsigned)trie.Size());
+			Assert::IsNotNull(trie.Find("levels/one.txt"));
+			Assert::IsNull(trie.Find("levels/one/sky/day.png"));
+			Assert::AreEqual(std::string("./levels"), trie.FindLongestPrefix("levels/one/sky/night.png")->key.ToString());
+
+			Assert::AreEqual(3u, (unsigned)trie.EraseUnder("./"));
+			Assert::AreEqual(0u, (unsigned)trie.Size());
+		}
+	};
+}
@@ -0,0 +1,71 @@
+#include "CppUnitTest.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+#include <string>
+#include "../AppServiceSandwich/SharedResourceCache.hpp"
+
+namespace Test
+{
+	TEST_CLASS(SharedResourceCacheTest)
+	{
+	public:
+
+		/*
+		 * TEST CASE: StoreAndAttach
+		 *
+		 * resources stored by the writer are visible through a read only cache attached by name,
+		 * the way another process would see them
+		 */
+
+		TEST_METHOD(StoreAndAttach)
+		{
+			SharedResourceCache writer("AppServiceSandwichTest.StoreAndAttach", 1 << 16, 64);
+			SharedResourceCache reader("AppServiceSandwichTest.StoreAndAttach");
+			Assert::IsTrue(writer.IsWritable());
+			Assert::IsFalse(reader.IsWritable());
+
+			uint64_t version = 0;
+			auto stored = writer.Store("mesh", "models/box.bin", "box v1", version);
+			Assert::AreEqual(uint64_t(1), version);
+			Assert::AreEqual(std::string("box v1"), stored.ToString());
+			// stored data is aligned so that it can be used in place
+			Assert::IsTrue(reinterpret_cast<uintptr_t>(stored.Data()) % 16 == 0);
+
+			auto found = reader.Find("mesh", "models/box.bin", version);
+			Assert::AreEqual(std::string("box v1"), found.ToString());
+			Assert::AreEqual(uint64_t(1), version);
+			Assert::IsTrue(reader.Find("texture", "models/box.bin", version).IsNull());
+			Assert::IsTrue(reader.Find("mesh", "models/ball.bin", version).IsNull());
+			Assert::IsTrue(reader.Store("mesh", "models/ball.bin", "ball", version).IsNull());
+
+			// a new version doesn't overwrite the previous one, views of it stay valid
+			writer.Store("mesh", "models/box.bin", "box v2", version);
+			Assert::AreEqual(uint64_t(2), version);
+			Assert::AreEqual(std::string("box v1"), found.ToString());
+			Assert::AreEqual(std::string("box v2"), reader.Find("mesh", "models/box.bin", version).ToString());
+			Assert::AreEqual(uint64_t(2), version);
+		}
+
+		/*
+		 * TEST CASE: FullCache
+		 *
+		 * when the data area or the table is full, Store fails and the caller keeps its own copy
+		 */
+
+		TEST_METHOD(FullCache)
+		{
+			SharedResourceCache cache("AppServiceSandwichTest.FullCache", 256, 4);
+			uint64_t version;
+			Assert::IsFalse(cache.Store("t", "a", std::string(100, 'a'), version).IsNull());
+			Assert::IsTrue(cache.Store("t", "b", std::string(200, 'b'), version).IsNull());
+			Assert::IsFalse(cache.Store("t", "c", "c", version).IsNull());
+			Assert::IsFalse(cache.Store("t", "d", "d", version).IsNull());
+			Assert::IsFalse(cache.Store("t", "e", "e", version).IsNull());
+			Assert::IsTrue(cache.Store("t", "f", "f", version).IsNull());
+			Assert::IsTrue(cache.DataUsed() <= cache.DataCapacity());
+
+			Assert::ExpectException<std::runtime_error>([] { SharedResourceCache missing("AppServiceSandwichTest.Missing"); });
+		}
+	};
+}
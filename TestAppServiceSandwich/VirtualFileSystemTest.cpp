@@ -0,0 +1,131 @@
+#include "CppUnitTest.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+#include <memory>
+#include <string>
+#include "../AppServiceSandwich/VirtualFileSystem.hpp"
+
+namespace Test
+{
+	TEST_CLASS(VirtualFileSystemTest)
+	{
+	public:
+
+		// counts how many times it was asked for a path
+		class CountingMount : public MemoryMount
+		{
+		public:
+			int reads = 0;
+
+			ResourceData Read(const ResourcePath& path) override
+			{
+				reads++;
+				return MemoryMount::Read(path);
+			}
+		};
+
+		static std::string ReadText(VirtualFileSystem& fileSystem, const ResourcePath& path)
+		{
+			auto data = fileSystem.Read(path);
+			return data.IsNull() ? "(missing)" : data.ToString();
+		}
+
+		/*
+		 * TEST CASE: MountOrder
+		 *
+		 * higher priority mounts are searched first, then the ones mounted later
+		 */
+
+		TEST_METHOD(MountOrder)
+		{
+			VirtualFileSystem fileSystem;
+			auto base = std::make_shared<MemoryMount>();
+			auto patch = std::make_shared<MemoryMount>();
+			auto fallback = std::make_shared<MemoryMount>();
+			base->Write("a.txt", "base a");
+			base->Write("b.txt", "base b");
+			patch->Write("a.txt", "patch a");
+			fallback->Write("a.txt", "fallback a");
+			fallback->Write("c.txt", "fallback c");
+			fileSystem.Mount(base);
+			fileSystem.Mount(fallback, -1);
+			fileSystem.Mount(patch);
+
+			Assert::AreEqual(std::string("patch a"), ReadText(fileSystem, "a.txt"));
+			Assert::AreEqual(std::string("base b"), ReadText(fileSystem, "./b.txt"));
+			Assert::AreEqual(std::string("fallback c"), ReadText(fileSystem, "c.txt"));
+			Assert::AreEqual(std::string("(missing)"), ReadText(fileSystem, "d.txt"));
+
+			Assert::IsTrue(fileSystem.Unmount(patch));
+			Assert::IsFalse(fileSystem.Unmount(patch));
+			Assert::AreEqual(std::string("base a"), ReadText(fileSystem, "a.txt"));
+		}
+
+		/*
+		 * TEST CASE: LookupsAreCached
+		 *
+		 * found and missing paths are remembered, so mounts are not probed again until the path is invalidated
+		 */
+
+		TEST_METHOD(LookupsAreCached)
+		{
+			VirtualFileSystem fileSystem;
+			auto first = std::make_shared<CountingMount>();
+			auto second = std::make_shared<CountingMount>();
+			fileSystem.Mount(second);
+			fileSystem.Mount(first);
+			second->Write("found.txt", "found");
+
+			for (int i = 0; i < 10; i++)
+			{
+				Assert::AreEqual(std::string("found"), ReadText(fileSystem, "found.txt"));
+				Assert::IsFalse(fileSystem.Exists("missing.txt"));
+			}
+			// each mount was searched once for each path, then only the mount which has it is read
+			Assert::AreEqual(2, first->reads);
+			Assert::AreEqual(11, second->reads);
+			auto statistics = fileSystem.GetStatistics();
+			Assert::AreEqual(20ull, statistics.lookups);
+			Assert::AreEqual(18ull, statistics.cacheHits);
+			Assert::AreEqual(9ull, statistics.cachedMisses);
+			Assert::AreEqual(size_t(2), fileSystem.CacheSize());
+
+			// a missing path stays missing until it's invalidated
+			first->Write("missing.txt", "created");
+			Assert::IsFalse(fileSystem.Exists("missing.txt"));
+			fileSystem.Invalidate("missing.txt");
+			Assert::AreEqual(std::string("created"), ReadText(fileSystem, "missing.txt"));
+
+			// a cached mount which lost the path is not trusted, all mounts are searched again
+			second->Remove("found.txt");
+			Assert::AreEqual(std::string("(missing)"), ReadText(fileSystem, "found.txt"));
+			Assert::IsFalse(fileSystem.Exists("found.txt"));
+		}
+
+		/*
+		 * TEST CASE: DirectoryMountPaths
+		 *
+		 * a directory can be mounted at another virtual path, changes on disk invalidate the virtual path
+		 */
+
+		TEST_METHOD(DirectoryMountPaths)
+		{
+			DirectoryMount mount("resources/test/assets", "assets");
+			ResourcePath path;
+			Assert::IsTrue(mount.ToVirtualPath("resources/test/assets/textures/stone.png", path));
+			Assert::IsTrue(path == ResourcePath("assets/textures/stone.png"));
+			Assert::IsFalse(mount.ToVirtualPath("resources/other/stone.png", path));
+			Assert::IsTrue(mount.Read("other/not_mounted_here.txt").IsNull());
+
+			VirtualFileSystem fileSystem;
+			auto memory = std::make_shared<MemoryMount>();
+			fileSystem.Mount(std::make_shared<DirectoryMount>("resources/test/assets", "assets"));
+			fileSystem.Mount(memory, -1);
+			Assert::IsFalse(fileSystem.Exists("assets/new.txt"));
+			memory->Write("assets/new.txt", "new");
+			fileSystem.Invalidate("resources/test/assets/new.txt");
+			Assert::AreEqual(std::string("new"), ReadText(fileSystem, "assets/new.txt"));
+		}
+	};
+}
\ No newline at end of file